@@ -21,19 +21,171 @@
  */
 
 #include "ara-dpd.h"
+#include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 namespace ara {
 
+RotatingBloomFilter::RotatingBloomFilter ()
+  : m_current (0),
+    m_size (0),
+    m_hashes (0),
+    m_capacity (0),
+    m_earlyRotations (0)
+{
+}
+
+void
+RotatingBloomFilter::Configure (uint32_t capacity, double falsePositiveRate, Time lifetime)
+{
+  NS_ASSERT (capacity > 0 && falsePositiveRate > 0 && falsePositiveRate < 1);
+  // Lookups check both filters, so each one is sized for half the rate;
+  // with both holding their capacity the combined rate stays below falsePositiveRate
+  double filterRate = falsePositiveRate / 2;
+  // Optimal size and number of hashes of a Bloom filter for the capacity and rate
+  double ln2 = std::log (2.0);
+  double bits = std::ceil (-(capacity * std::log (filterRate)) / (ln2 * ln2));
+  m_size = ((uint32_t (bits) + 63) / 64) * 64;
+  m_hashes = std::max (1, int (std::floor (double (m_size) / capacity * ln2 + 0.5)));
+  m_capacity = capacity;
+  m_lifetime = lifetime;
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      m_filters[i].m_bits.assign (m_size / 64, 0);
+      m_filters[i].m_setBits = 0;
+      m_filters[i].m_keys = 0;
+    }
+  m_rotate = Simulator::Now () + m_lifetime;
+  m_earlyRotations = 0;
+}
+
+bool
+RotatingBloomFilter::Insert (uint64_t key)
+{
+  NS_ASSERT (m_size > 0);
+  if (Simulator::Now () >= m_rotate)
+    {
+      Rotate ();
+    }
+  else if (m_filters[m_current].m_keys >= m_capacity)
+    {
+      // The previous filter is cleared before its keys are one lifetime old
+      ++m_earlyRotations;
+      Rotate ();
+    }
+  // Mix the key, then derive the bit positions by double hashing
+  uint64_t h = key + 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  uint32_t h1 = uint32_t (h);
+  uint32_t h2 = uint32_t (h >> 32) | 1;
+  if (Contains (m_filters[0], h1, h2) || Contains (m_filters[1], h1, h2))
+    {
+      return true;
+    }
+  Filter & filter = m_filters[m_current];
+  for (uint32_t i = 0; i < m_hashes; ++i)
+    {
+      uint32_t bit = (h1 + i * h2) % m_size;
+      uint64_t mask = uint64_t (1) << (bit % 64);
+      if ((filter.m_bits[bit / 64] & mask) == 0)
+        {
+          filter.m_bits[bit / 64] |= mask;
+          ++filter.m_setBits;
+        }
+    }
+  ++filter.m_keys;
+  return false;
+}
+
+uint32_t
+RotatingBloomFilter::GetMemoryUsage () const
+{
+  return 2 * m_size / 8;
+}
+
+double
+RotatingBloomFilter::GetFalsePositiveRate () const
+{
+  if (m_size == 0)
+    {
+      return 0;
+    }
+  double trueNegative = 1;
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      double fill = double (m_filters[i].m_setBits) / m_size;
+      trueNegative *= 1 - std::pow (fill, double (m_hashes));
+    }
+  return 1 - trueNegative;
+}
+
+bool
+RotatingBloomFilter::Contains (Filter const & filter, uint32_t h1, uint32_t h2) const
+{
+  if (filter.m_keys == 0)
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < m_hashes; ++i)
+    {
+      uint32_t bit = (h1 + i * h2) % m_size;
+      if ((filter.m_bits[bit / 64] & (uint64_t (1) << (bit % 64))) == 0)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+RotatingBloomFilter::Rotate ()
+{
+  m_current = 1 - m_current;
+  Filter & filter = m_filters[m_current];
+  std::fill (filter.m_bits.begin (), filter.m_bits.end (), 0);
+  filter.m_setBits = 0;
+  filter.m_keys = 0;
+  m_rotate = Simulator::Now () + m_lifetime;
+}
+
+DuplicatePacketDetection::DuplicatePacketDetection (Time lifetime)
+  : m_idCache (lifetime),
+    m_mode (DPD_EXACT),
+    m_bloomPackets (10000),
+    m_bloomFalsePositiveRate (0.001),
+    m_duplicates (0)
+{
+}
+
 bool
 DuplicatePacketDetection::IsDuplicate  (Ptr<const Packet> p, const Ipv4Header & header)
 {
-  return m_idCache.IsDuplicate (header.GetSource (), p->GetUid () );
+  bool duplicate;
+  if (m_mode == DPD_BLOOM)
+    {
+      duplicate = m_filter.Insert ((uint64_t (header.GetSource ().Get ()) << 32) | p->GetUid ());
+    }
+  else
+    {
+      duplicate = m_idCache.IsDuplicate (header.GetSource (), p->GetUid () );
+    }
+  if (duplicate)
+    {
+      ++m_duplicates;
+    }
+  return duplicate;
 }
 void
 DuplicatePacketDetection::SetLifetime (Time lifetime)
 {
   m_idCache.SetLifetime (lifetime);
+  if (m_mode == DPD_BLOOM)
+    {
+      m_filter.Configure (m_bloomPackets, m_bloomFalsePositiveRate, lifetime);
+    }
 }
 
 Time
@@ -42,7 +194,67 @@ DuplicatePacketDetection::GetLifetime () const
   return m_idCache.GetLifeTime ();
 }
 
+void
+DuplicatePacketDetection::SetMode (DuplicateDetectionMode mode)
+{
+  m_mode = mode;
+  m_idCache.SetMode (ID_CACHE_EXACT);
+  if (m_mode == DPD_BLOOM)
+    {
+      m_filter.Configure (m_bloomPackets, m_bloomFalsePositiveRate, GetLifetime ());
+    }
+  else
+    {
+      // Release the filter bits
+      m_filter = RotatingBloomFilter ();
+    }
+}
+
+DuplicateDetectionMode
+DuplicatePacketDetection::GetMode () const
+{
+  return m_mode;
+}
+
+void
+DuplicatePacketDetection::SetBloomFilter (uint32_t packets, double falsePositiveRate)
+{
+  m_bloomPackets = packets;
+  m_bloomFalsePositiveRate = falsePositiveRate;
+  if (m_mode == DPD_BLOOM)
+    {
+      m_filter.Configure (m_bloomPackets, m_bloomFalsePositiveRate, GetLifetime ());
+    }
+}
+
+uint64_t
+DuplicatePacketDetection::GetDuplicates () const
+{
+  return m_duplicates;
+}
+
+uint32_t
+DuplicatePacketDetection::GetMemoryUsage ()
+{
+  if (m_mode == DPD_BLOOM)
+    {
+      return m_filter.GetMemoryUsage ();
+    }
+  // A hash set node and bucket plus the bucket list entry per packet
+  return m_idCache.GetSize () * 4 * sizeof (uint64_t);
+}
 
+double
+DuplicatePacketDetection::GetFalsePositiveRate () const
+{
+  return m_mode == DPD_BLOOM ? m_filter.GetFalsePositiveRate () : 0;
 }
+
+uint64_t
+DuplicatePacketDetection::GetEarlyRotations () const
+{
+  return m_mode == DPD_BLOOM ? m_filter.GetEarlyRotations () : 0;
 }
 
+}
+}
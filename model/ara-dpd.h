@@ -27,9 +27,99 @@
 #include "ns3/nstime.h"
 #include "ns3/packet.h"
 #include "ns3/ipv4-header.h"
+#include <vector>
 
 namespace ns3 {
 namespace ara {
+/**
+ * \ingroup ara
+ * \brief How DuplicatePacketDetection remembers packets
+ */
+enum DuplicateDetectionMode
+{
+  DPD_EXACT = 0,  //!< One record per packet
+  DPD_BLOOM = 1,  //!< A rotating pair of Bloom filters, with false positives
+};
+
+/**
+ * \ingroup ara
+ * \brief Pair of Bloom filters that forget keys after a lifetime
+ *
+ * Keys are added to the current filter and looked up in both.  The current
+ * filter becomes the previous one, and the previous one is cleared, once per
+ * lifetime or when the current filter holds its capacity, whichever comes
+ * first.  Keys are remembered for one to two lifetimes, unless the filters
+ * rotate early because of their capacity: under a load above the capacity
+ * per lifetime keys are forgotten in less than one lifetime, and duplicates
+ * arriving later are accepted as new.  Early rotations are counted so that
+ * such an undersized configuration can be detected.
+ */
+class RotatingBloomFilter
+{
+public:
+  RotatingBloomFilter ();
+  /**
+   * Size the filters and clear them
+   * \param capacity the number of keys per filter
+   * \param falsePositiveRate the false positive rate of a lookup with both filters holding their capacity
+   * \param lifetime the time between rotations
+   */
+  void Configure (uint32_t capacity, double falsePositiveRate, Time lifetime);
+  /**
+   * Check whether a key was added, and add it if not
+   * \param key the key
+   * \returns true if the key was probably added before
+   */
+  bool Insert (uint64_t key);
+  /// \returns the number of bytes of the filter bits
+  uint32_t GetMemoryUsage () const;
+  /**
+   * The false positive rate is not measured, which would need the true set
+   * of keys: it is estimated from the fraction of set bits of each filter.
+   * \returns the probability that a new key is reported as known, estimated from the filter fill
+   */
+  double GetFalsePositiveRate () const;
+  /// \returns the number of rotations caused by a full filter since the filters were configured
+  uint64_t GetEarlyRotations () const
+  {
+    return m_earlyRotations;
+  }
+
+private:
+  /// Bloom filter
+  struct Filter
+  {
+    std::vector<uint64_t> m_bits; ///< the bits
+    uint32_t m_setBits; ///< number of set bits
+    uint32_t m_keys; ///< number of keys added
+  };
+  /**
+   * \param filter the filter
+   * \param h1 the first key hash
+   * \param h2 the second key hash
+   * \returns true if all bits of the key are set
+   */
+  bool Contains (Filter const & filter, uint32_t h1, uint32_t h2) const;
+  /// Make the current filter the previous one and clear the new current one
+  void Rotate ();
+  /// Current and previous filter
+  Filter m_filters[2];
+  /// Index of the current filter
+  uint32_t m_current;
+  /// Number of bits per filter
+  uint32_t m_size;
+  /// Number of bits per key
+  uint32_t m_hashes;
+  /// Number of keys per filter
+  uint32_t m_capacity;
+  /// Time between rotations
+  Time m_lifetime;
+  /// When the filters rotate
+  Time m_rotate;
+  /// Number of rotations caused by a full filter
+  uint64_t m_earlyRotations;
+};
+
 /**
  * \ingroup ara
  *
@@ -37,6 +127,9 @@ namespace ara {
  *
  * Currently duplicate detection is based on unique packet ID given by Packet::GetUid ()
  * This approach is known to be weak (ns3::Packet UID is an internal identifier and not intended for logical uniqueness in models) and should be changed.
+ *
+ * Packets are remembered exactly by an IdCache, or by a RotatingBloomFilter
+ * that uses constant memory and may report new packets as duplicates.
  */
 class DuplicatePacketDetection
 {
@@ -45,9 +138,7 @@ public:
    * Constructor
    * \param lifetime the lifetime for added entries
    */
-  DuplicatePacketDetection (Time lifetime) : m_idCache (lifetime)
-  {
-  }
+  DuplicatePacketDetection (Time lifetime);
   /**
    * Check if the packet is a duplicate. If not, save information about this packet.
    * \param p the packet to check
@@ -65,9 +156,40 @@ public:
    * \returns the duplicate record lifetime
    */
   Time GetLifetime () const;
+  /**
+   * Set how packets are remembered.  Seen packets are forgotten.
+   * \param mode the detection mode
+   */
+  void SetMode (DuplicateDetectionMode mode);
+  /// \returns how packets are remembered
+  DuplicateDetectionMode GetMode () const;
+  /**
+   * Size the Bloom filters.  Seen packets are forgotten in Bloom filter mode.
+   * \param packets the expected number of packets per lifetime
+   * \param falsePositiveRate the false positive rate with both filters at that number of packets
+   */
+  void SetBloomFilter (uint32_t packets, double falsePositiveRate);
+  /// \returns the number of packets reported as duplicates
+  uint64_t GetDuplicates () const;
+  /// \returns the approximate number of bytes used to remember packets
+  uint32_t GetMemoryUsage ();
+  /// \returns the false positive rate estimated from the Bloom filter fill, not measured; zero in exact mode
+  double GetFalsePositiveRate () const;
+  /// \returns the number of Bloom filter rotations caused by a full filter, zero in exact mode
+  uint64_t GetEarlyRotations () const;
 private:
   /// Impl
   IdCache m_idCache;
+  /// Bloom filters of the Bloom filter mode
+  RotatingBloomFilter m_filter;
+  /// How packets are remembered
+  DuplicateDetectionMode m_mode;
+  /// Expected number of packets per lifetime
+  uint32_t m_bloomPackets;
+  /// False positive rate with both filters at the expected number of packets
+  double m_bloomFalsePositiveRate;
+  /// Number of packets reported as duplicates
+  uint64_t m_duplicates;
 };
 
 }
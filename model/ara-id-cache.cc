@@ -28,37 +28,201 @@
 
 namespace ns3 {
 namespace ara {
+
+const uint32_t IdCache::BUCKETS_PER_LIFETIME;
+const uint32_t IdCache::WINDOW_SIZE;
+
 bool
 IdCache::IsDuplicate (Ipv4Address addr, uint32_t id)
 {
+  if (m_mode == ID_CACHE_WINDOW)
+    {
+      return IsDuplicateInWindow (addr, id);
+    }
   Purge ();
-  for (std::vector<UniqueId>::const_iterator i = m_idCache.begin ();
-       i != m_idCache.end (); ++i)
+  uint64_t key = (uint64_t (addr.Get ()) << 32) | id;
+  if (!m_idCache.insert (key).second)
     {
-      if (i->m_context == addr && i->m_id == id)
+      return true;
+    }
+  Time now = Simulator::Now ();
+  if (m_buckets.empty () || m_buckets.back ().m_close <= now)
+    {
+      Time interval = m_lifetime / BUCKETS_PER_LIFETIME;
+      Bucket bucket;
+      bucket.m_close = now + interval;
+      bucket.m_expire = bucket.m_close + m_lifetime;
+      // Purge expects buckets to expire in order, also after the lifetime was lowered
+      if (!m_buckets.empty ())
         {
-          return true;
+          bucket.m_expire = std::max (bucket.m_expire, m_buckets.back ().m_expire);
         }
+      m_buckets.push_back (bucket);
     }
-  struct UniqueId uniqueId =
-  {
-    addr, id, m_lifetime + Simulator::Now ()
-  };
-  m_idCache.push_back (uniqueId);
+  m_buckets.back ().m_keys.push_back (key);
   return false;
 }
+bool
+IdCache::IsDuplicateInWindow (Ipv4Address addr, uint32_t id)
+{
+  Time now = Simulator::Now ();
+  std::pair<std::unordered_map<uint32_t, Window>::iterator, bool> inserted =
+    m_windows.insert (std::make_pair (addr.Get (), Window ()));
+  Window & w = inserted.first->second;
+  if (inserted.second || w.m_expire < now)
+    {
+      w.m_highest = id;
+      w.m_seen[0] = 1;
+      w.m_seen[1] = 0;
+      w.m_expire = now + m_lifetime;
+      return false;
+    }
+  // Signed distance, so that IDs may wrap around
+  int32_t ahead = int32_t (id - w.m_highest);
+  if (ahead > 0)
+    {
+      uint32_t shift = ahead;
+      if (shift >= WINDOW_SIZE)
+        {
+          w.m_seen[1] = 0;
+          w.m_seen[0] = 0;
+        }
+      else if (shift >= 64)
+        {
+          w.m_seen[1] = w.m_seen[0] << (shift - 64);
+          w.m_seen[0] = 0;
+        }
+      else
+        {
+          w.m_seen[1] = (w.m_seen[1] << shift) | (w.m_seen[0] >> (64 - shift));
+          w.m_seen[0] <<= shift;
+        }
+      w.m_seen[0] |= 1;
+      w.m_highest = id;
+      w.m_expire = now + m_lifetime;
+      return false;
+    }
+  uint32_t behind = -ahead;
+  if (behind >= WINDOW_SIZE)
+    {
+      return true;
+    }
+  uint64_t mask = uint64_t (1) << (behind % 64);
+  if (w.m_seen[behind / 64] & mask)
+    {
+      return true;
+    }
+  w.m_seen[behind / 64] |= mask;
+  return false;
+}
+
 void
 IdCache::Purge ()
 {
-  m_idCache.erase (remove_if (m_idCache.begin (), m_idCache.end (),
-                              IsExpired ()), m_idCache.end ());
+  Time now = Simulator::Now ();
+  for (std::unordered_map<uint32_t, Window>::iterator i = m_windows.begin (); i != m_windows.end (); )
+    {
+      if (i->second.m_expire < now)
+        {
+          i = m_windows.erase (i);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  while (!m_buckets.empty () && m_buckets.front ().m_expire < now)
+    {
+      std::vector<uint64_t> const & keys = m_buckets.front ().m_keys;
+      for (std::vector<uint64_t>::const_iterator i = keys.begin (); i != keys.end (); ++i)
+        {
+          m_idCache.erase (*i);
+        }
+      m_buckets.pop_front ();
+    }
 }
 
 uint32_t
 IdCache::GetSize ()
 {
   Purge ();
-  return m_idCache.size ();
+  return m_mode == ID_CACHE_WINDOW ? m_windows.size () : m_idCache.size ();
+}
+
+void
+IdCache::SetMode (IdCacheMode mode)
+{
+  m_mode = mode;
+  m_idCache.clear ();
+  m_buckets.clear ();
+  m_windows.clear ();
+}
+
+void
+FantPathCache::AddFirst (Ipv4Address origin, uint32_t id, Ipv4Address prevHop, uint16_t hops)
+{
+  Purge ();
+  uint64_t key = (uint64_t (origin.Get ()) << 32) | id;
+  Record & record = m_records[key];
+  record.m_hops = hops;
+  record.m_prevHops.assign (1, prevHop);
+  record.m_replies = 0;
+  record.m_expire = Simulator::Now () + m_lifetime;
+  // Purge expects records to expire in order, also after the lifetime was lowered
+  if (!m_expiry.empty ())
+    {
+      record.m_expire = std::max (record.m_expire, m_expiry.back ().first);
+    }
+  m_expiry.push_back (std::make_pair (record.m_expire, key));
+}
+
+bool
+FantPathCache::AddAlternative (Ipv4Address origin, uint32_t id, Ipv4Address prevHop, uint16_t hops, uint32_t maxPaths)
+{
+  Purge ();
+  std::unordered_map<uint64_t, Record>::iterator i = m_records.find ((uint64_t (origin.Get ()) << 32) | id);
+  if (i == m_records.end () || hops > i->second.m_hops || i->second.m_prevHops.size () >= maxPaths)
+    {
+      return false;
+    }
+  std::vector<Ipv4Address> & prevHops = i->second.m_prevHops;
+  if (std::find (prevHops.begin (), prevHops.end (), prevHop) != prevHops.end ())
+    {
+      return false;
+    }
+  prevHops.push_back (prevHop);
+  i->second.m_hops = hops;
+  return true;
+}
+
+bool
+FantPathCache::NextReverseHop (Ipv4Address origin, uint32_t id, Ipv4Address & prevHop)
+{
+  Purge ();
+  std::unordered_map<uint64_t, Record>::iterator i = m_records.find ((uint64_t (origin.Get ()) << 32) | id);
+  if (i == m_records.end ())
+    {
+      return false;
+    }
+  Record & record = i->second;
+  prevHop = record.m_prevHops[record.m_replies++ % record.m_prevHops.size ()];
+  return true;
+}
+
+void
+FantPathCache::Purge ()
+{
+  Time now = Simulator::Now ();
+  while (!m_expiry.empty () && m_expiry.front ().first < now)
+    {
+      // A record added again for the same FANT has a later expiration time
+      std::unordered_map<uint64_t, Record>::iterator i = m_records.find (m_expiry.front ().second);
+      if (i != m_records.end () && i->second.m_expire == m_expiry.front ().first)
+        {
+          m_records.erase (i);
+        }
+      m_expiry.pop_front ();
+    }
 }
 
 }
@@ -31,14 +31,37 @@
 
 #include "ns3/ipv4-address.h"
 #include "ns3/simulator.h"
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace ns3 {
 namespace ara {
+/**
+ * \ingroup ara
+ * \brief How an IdCache remembers IDs
+ */
+enum IdCacheMode
+{
+  ID_CACHE_EXACT = 0,   //!< One record per (address, id) pair, for any IDs
+  ID_CACHE_WINDOW = 1,  //!< A sliding window per address, for IDs that increase per address
+};
+
 /**
  * \ingroup ara
  *
  * \brief Unique packets identification cache used for simple duplicate detection.
+ *
+ * IDs are kept in a hash set and expire in coarse time buckets: every ID
+ * added within one bucket interval expires with the bucket, between one
+ * lifetime and one lifetime plus one bucket interval after it was added.
+ *
+ * In window mode the IDs of each address are expected to increase, like
+ * FANT IDs.  The cache keeps the highest ID per address and a bitmap of the
+ * WINDOW_SIZE IDs below it.  IDs that fell out of the window count as
+ * duplicates.  The window of an address is forgotten when no new ID was
+ * seen from it for one lifetime.
  */
 class IdCache
 {
@@ -47,7 +70,9 @@ public:
    * constructor
    * \param lifetime the lifetime for added entries
    */
-  IdCache (Time lifetime) : m_lifetime (lifetime)
+  IdCache (Time lifetime, IdCacheMode mode = ID_CACHE_EXACT)
+    : m_lifetime (lifetime),
+      m_mode (mode)
   {
   }
   /**
@@ -60,11 +85,25 @@ public:
   /// Remove all expired entries
   void Purge ();
   /**
-   * \returns number of entries in cache
+   * \returns number of entries in cache, IDs in exact mode and addresses in window mode
    */
   uint32_t GetSize ();
   /**
-   * Set lifetime for future added entries.
+   * Set how IDs are remembered.  The cache is emptied.
+   * \param mode the cache mode
+   */
+  void SetMode (IdCacheMode mode);
+  /**
+   * \returns how IDs are remembered
+   */
+  IdCacheMode GetMode () const
+  {
+    return m_mode;
+  }
+  /**
+   * Set lifetime for future added entries.  Entries expire in the order they
+   * were added, so after the lifetime is lowered new entries live until the
+   * entries added before them expire, at most one old lifetime.
    * \param lifetime the lifetime for entries
    */
   void SetLifetime (Time lifetime)
@@ -80,35 +119,145 @@ public:
     return m_lifetime;
   }
 private:
-  /// Unique packet ID
-  struct UniqueId
+  /// Number of bucket intervals per lifetime
+  static const uint32_t BUCKETS_PER_LIFETIME = 16;
+  /// IDs added within one bucket interval
+  struct Bucket
   {
-    /// ID is supposed to be unique in single address context (e.g. sender address)
-    Ipv4Address m_context;
-    /// The id
-    uint32_t m_id;
-    /// When record will expire
+    /// When the bucket stops taking new IDs
+    Time m_close;
+    /// When the IDs of the bucket expire
+    Time m_expire;
+    /// Keys of the IDs
+    std::vector<uint64_t> m_keys;
+  };
+  /// Number of IDs below the highest one remembered in window mode
+  static const uint32_t WINDOW_SIZE = 128;
+  /// Recently seen IDs of an address
+  struct Window
+  {
+    /// Highest ID seen
+    uint32_t m_highest;
+    /// Bit i is set if ID m_highest - i was seen
+    uint64_t m_seen[WINDOW_SIZE / 64];
+    /// When the window is forgotten
     Time m_expire;
   };
   /**
-   * \brief IsExpired structure
+   * Check and add an ID in window mode
+   * \param addr the IP address
+   * \param id the ID
+   * \returns true if the ID was seen
    */
-  struct IsExpired
+  bool IsDuplicateInWindow (Ipv4Address addr, uint32_t id);
+  /// Windows of the addresses
+  std::unordered_map<uint32_t, Window> m_windows;
+  /// Already seen IDs, as (address, id) keys
+  std::unordered_set<uint64_t> m_idCache;
+  /// Buckets in the order they were opened
+  std::deque<Bucket> m_buckets;
+  /// Default lifetime for ID records
+  Time m_lifetime;
+  /// How IDs are remembered
+  IdCacheMode m_mode;
+};
+
+/**
+ * \ingroup ara
+ *
+ * \brief Previous hops of recent FANTs, for multipath route discovery.
+ *
+ * A FANT is identified by its origin and ID.  The cache remembers the
+ * smallest hop count of the copies accepted so far and their previous hops.
+ * A later copy is accepted as an alternative reverse path if it comes from a
+ * new previous hop and is no longer than the shortest accepted copy, so that
+ * every previous hop is strictly closer to the origin than this node.  Two
+ * neighbors at the same distance from the origin thus never use each other,
+ * and the reverse paths cannot form loops.  Records expire one lifetime after
+ * the first copy.
+ *
+ * BANTs answering the FANT take its previous hops in round robin: each
+ * record counts the BANTs relayed for its FANT, and the n-th one goes to the
+ * n-th recorded previous hop modulo their number.  A BANT is not tied to the
+ * path its FANT copy took, so replies spread over the reverse paths known at
+ * each node but may merge again further upstream.
+ */
+class FantPathCache
+{
+public:
+  /**
+   * constructor
+   * \param lifetime the lifetime of records
+   */
+  FantPathCache (Time lifetime)
+    : m_lifetime (lifetime)
   {
-    /**
-     * \brief Check if the entry is expired
-     *
-     * \param u UniqueId entry
-     * \return true if expired, false otherwise
-     */
-    bool operator() (const struct UniqueId & u) const
-    {
-      return (u.m_expire < Simulator::Now ());
-    }
+  }
+  /**
+   * Record the first copy of a FANT
+   * \param origin the origin of the FANT
+   * \param id the FANT ID
+   * \param prevHop the neighbor the copy was received from
+   * \param hops the hop count of the copy
+   */
+  void AddFirst (Ipv4Address origin, uint32_t id, Ipv4Address prevHop, uint16_t hops);
+  /**
+   * Check a later copy of a FANT and record its previous hop if it is accepted
+   * \param origin the origin of the FANT
+   * \param id the FANT ID
+   * \param prevHop the neighbor the copy was received from
+   * \param hops the hop count of the copy
+   * \param maxPaths the maximum number of previous hops per FANT
+   * \returns true if the copy is accepted as an alternative reverse path
+   */
+  bool AddAlternative (Ipv4Address origin, uint32_t id, Ipv4Address prevHop, uint16_t hops, uint32_t maxPaths);
+  /**
+   * Choose the previous hop to relay the next BANT answering a FANT to,
+   * taking the accepted previous hops in turn, the first one first
+   * \param origin the origin of the FANT
+   * \param id the FANT ID
+   * \param prevHop the previous hop, if the FANT is known
+   * \returns true if the FANT is known
+   */
+  bool NextReverseHop (Ipv4Address origin, uint32_t id, Ipv4Address & prevHop);
+  /// Remove all expired records
+  void Purge ();
+  /**
+   * \returns the number of FANTs remembered
+   */
+  uint32_t GetSize ()
+  {
+    Purge ();
+    return m_records.size ();
+  }
+  /**
+   * Set lifetime for future records.  Records expire in the order they were
+   * added, so after the lifetime is lowered new records live until the
+   * records added before them expire, at most one old lifetime.
+   * \param lifetime the lifetime of records
+   */
+  void SetLifetime (Time lifetime)
+  {
+    m_lifetime = lifetime;
+  }
+private:
+  /// Previous hops of one FANT
+  struct Record
+  {
+    /// Smallest hop count of the accepted copies
+    uint16_t m_hops;
+    /// Previous hops of the accepted copies, the first one first
+    std::vector<Ipv4Address> m_prevHops;
+    /// Number of BANTs relayed for the FANT
+    uint32_t m_replies;
+    /// When the record expires
+    Time m_expire;
   };
-  /// Already seen IDs
-  std::vector<UniqueId> m_idCache;
-  /// Default lifetime for ID records
+  /// Records, keyed by (origin, id)
+  std::unordered_map<uint64_t, Record> m_records;
+  /// Expiration times and keys of the records, in the order they were added
+  std::deque<std::pair<Time, uint64_t> > m_expiry;
+  /// Lifetime of records
   Time m_lifetime;
 };
 
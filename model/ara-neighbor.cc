@@ -27,6 +27,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include "ns3/log.h"
 #include "ns3/wifi-mac-header.h"
 #include "ara-neighbor.h"
@@ -37,113 +38,143 @@ NS_LOG_COMPONENT_DEFINE ("AraNeighbors");
 
 namespace ara {
 Neighbors::Neighbors (Time delay)
-  : m_ntimer (Timer::CANCEL_ON_DESTROY)
+  : m_ntimer (Timer::CANCEL_ON_DESTROY),
+    m_granularity (delay),
+    m_timerEvents (0),
+    m_linkQualityWeight (0.1),
+    m_maxTxErrors (3),
+    m_linkQualityThreshold (0.2)
 {
-  m_ntimer.SetDelay (delay);
   m_ntimer.SetFunction (&Neighbors::Purge, this);
   m_txErrorCallback = MakeCallback (&Neighbors::ProcessTxError, this);
+  m_txOkCallback = MakeCallback (&Neighbors::ProcessTxOk, this);
+  m_txDataFailedCallback = MakeCallback (&Neighbors::ProcessTxDataFailed, this);
 }
 
 bool
 Neighbors::IsNeighbor (Ipv4Address addr)
 {
-  Purge ();
-  for (std::vector<Neighbor>::const_iterator i = m_nb.begin ();
-       i != m_nb.end (); ++i)
-    {
-      if (i->m_neighborAddress == addr)
-        {
-          return true;
-        }
-    }
-  return false;
+  std::unordered_map<uint32_t, Neighbor>::const_iterator i = m_nb.find (addr.Get ());
+  return i != m_nb.end () && i->second.m_expireTime >= Simulator::Now ();
 }
 
 Time
 Neighbors::GetExpireTime (Ipv4Address addr)
 {
-  Purge ();
-  for (std::vector<Neighbor>::const_iterator i = m_nb.begin (); i
-       != m_nb.end (); ++i)
+  std::unordered_map<uint32_t, Neighbor>::const_iterator i = m_nb.find (addr.Get ());
+  if (i == m_nb.end () || i->second.m_expireTime < Simulator::Now ())
     {
-      if (i->m_neighborAddress == addr)
-        {
-          return (i->m_expireTime - Simulator::Now ());
-        }
+      return Seconds (0);
     }
-  return Seconds (0);
+  return (i->second.m_expireTime - Simulator::Now ());
 }
 
 void
 Neighbors::Update (Ipv4Address addr, Time expire)
 {
-  for (std::vector<Neighbor>::iterator i = m_nb.begin (); i != m_nb.end (); ++i)
+  std::unordered_map<uint32_t, Neighbor>::iterator i = m_nb.find (addr.Get ());
+  if (i != m_nb.end ())
     {
-      if (i->m_neighborAddress == addr)
+      i->second.m_expireTime
+        = std::max (expire + Simulator::Now (), i->second.m_expireTime);
+      if (i->second.m_hardwareAddress == Mac48Address ())
         {
-          i->m_expireTime
-            = std::max (expire + Simulator::Now (), i->m_expireTime);
-          if (i->m_hardwareAddress == Mac48Address ())
-            {
-              i->m_hardwareAddress = LookupMacAddress (i->m_neighborAddress);
-            }
-          return;
+          SetHardwareAddress (i->second, LookupMacAddress (addr));
         }
+      return;
     }
 
   NS_LOG_LOGIC ("Open link to " << addr);
-  Neighbor neighbor (addr, LookupMacAddress (addr), expire + Simulator::Now ());
-  m_nb.push_back (neighbor);
-  Purge ();
+  Neighbor neighbor (addr, Mac48Address (), expire + Simulator::Now ());
+  i = m_nb.insert (std::make_pair (addr.Get (), neighbor)).first;
+  SetHardwareAddress (i->second, LookupMacAddress (addr));
+  m_expiryIndex.push (std::make_pair (neighbor.m_indexedExpiry, addr));
+  ScheduleTimer ();
 }
 
-/**
- * \brief CloseNeighbor structure
- */
-struct CloseNeighbor
-{
-  /**
-   * Check if the entry is expired
-   *
-   * \param nb Neighbors::Neighbor entry
-   * \return true if expired, false otherwise
-   */
-  bool operator() (const Neighbors::Neighbor & nb) const
-  {
-    return ((nb.m_expireTime < Simulator::Now ()) || nb.close);
-  }
-};
+void
+Neighbors::Update (Ipv4Address first, Ipv4Address second, Time expire)
+{
+  Update (first, expire);
+  if (second != first)
+    {
+      Update (second, expire);
+    }
+}
 
 void
 Neighbors::Purge ()
 {
-  if (m_nb.empty ())
+  Time now = Simulator::Now ();
+  std::vector<Ipv4Address> closed;
+  while (!m_expiryIndex.empty () && m_expiryIndex.top ().first < now)
     {
-      return;
+      ExpiryRecord record = m_expiryIndex.top ();
+      m_expiryIndex.pop ();
+      std::unordered_map<uint32_t, Neighbor>::iterator i = m_nb.find (record.second.Get ());
+      if (i == m_nb.end () || i->second.m_indexedExpiry != record.first)
+        {
+          continue;
+        }
+      if (i->second.m_expireTime < now)
+        {
+          closed.push_back (i->second.m_neighborAddress);
+        }
+      else
+        {
+          i->second.m_indexedExpiry = i->second.m_expireTime;
+          m_expiryIndex.push (std::make_pair (i->second.m_indexedExpiry, record.second));
+        }
     }
+  CloseLinks (closed);
+  ScheduleTimer ();
+}
 
-  CloseNeighbor pred;
+void
+Neighbors::CloseLinks (std::vector<Ipv4Address> & addresses)
+{
+  // Notify in address order, independent of the hash table layout
+  std::sort (addresses.begin (), addresses.end ());
+  for (std::vector<Ipv4Address>::const_iterator j = addresses.begin (); j != addresses.end (); ++j)
+    {
+      std::unordered_map<uint32_t, Neighbor>::iterator i = m_nb.find (j->Get ());
+      // A neighbor coming back starts without an estimate
+      ReportLinkQuality (i->second, 1);
+      SetHardwareAddress (i->second, Mac48Address ());
+      m_nb.erase (i);
+    }
   if (!m_handleLinkFailure.IsNull ())
     {
-      for (std::vector<Neighbor>::iterator j = m_nb.begin (); j != m_nb.end (); ++j)
+      for (std::vector<Ipv4Address>::const_iterator j = addresses.begin (); j != addresses.end (); ++j)
         {
-          if (pred (*j))
-            {
-              NS_LOG_LOGIC ("Close link to " << j->m_neighborAddress);
-              m_handleLinkFailure (j->m_neighborAddress);
-            }
+          NS_LOG_LOGIC ("Close link to " << *j);
+          m_handleLinkFailure (*j);
         }
     }
-  m_nb.erase (std::remove_if (m_nb.begin (), m_nb.end (), pred), m_nb.end ());
-  m_ntimer.Cancel ();
-  m_ntimer.Schedule ();
 }
 
 void
 Neighbors::ScheduleTimer ()
 {
+  if (m_expiryIndex.empty ())
+    {
+      return;
+    }
+  // Neighbors expire once their deadline has passed, so fire strictly after it
+  Time deadline = m_expiryIndex.top ().first;
+  Time expiry = deadline + TimeStep (1);
+  if (m_granularity.IsStrictlyPositive ())
+    {
+      expiry = TimeStep ((deadline.GetTimeStep () / m_granularity.GetTimeStep () + 1) * m_granularity.GetTimeStep ());
+    }
+  if (m_ntimer.IsRunning () && m_timerExpiry == expiry)
+    {
+      return;
+    }
   m_ntimer.Cancel ();
-  m_ntimer.Schedule ();
+  m_ntimer.Schedule (expiry - Simulator::Now ());
+  m_timerExpiry = expiry;
+  ++m_timerEvents;
 }
 
 void
@@ -158,6 +189,42 @@ Neighbors::DelArpCache (Ptr<ArpCache> a)
   m_arp.erase (std::remove (m_arp.begin (), m_arp.end (), a), m_arp.end ());
 }
 
+uint64_t
+Neighbors::GetMacKey (Mac48Address addr)
+{
+  uint8_t buf[6];
+  addr.CopyTo (buf);
+  uint64_t key = 0;
+  for (uint32_t i = 0; i < 6; ++i)
+    {
+      key = (key << 8) | buf[i];
+    }
+  return key;
+}
+
+void
+Neighbors::SetHardwareAddress (Neighbor & neighbor, Mac48Address addr)
+{
+  if (neighbor.m_hardwareAddress != Mac48Address ())
+    {
+      typedef std::unordered_multimap<uint64_t, uint32_t>::iterator Iterator;
+      std::pair<Iterator, Iterator> range = m_macIndex.equal_range (GetMacKey (neighbor.m_hardwareAddress));
+      for (Iterator i = range.first; i != range.second; ++i)
+        {
+          if (i->second == neighbor.m_neighborAddress.Get ())
+            {
+              m_macIndex.erase (i);
+              break;
+            }
+        }
+    }
+  neighbor.m_hardwareAddress = addr;
+  if (addr != Mac48Address ())
+    {
+      m_macIndex.insert (std::make_pair (GetMacKey (addr), neighbor.m_neighborAddress.Get ()));
+    }
+}
+
 Mac48Address
 Neighbors::LookupMacAddress (Ipv4Address addr)
 {
@@ -180,14 +247,106 @@ Neighbors::ProcessTxError (WifiMacHeader const & hdr)
 {
   Mac48Address addr = hdr.GetAddr1 ();
 
-  for (std::vector<Neighbor>::iterator i = m_nb.begin (); i != m_nb.end (); ++i)
+  std::vector<Ipv4Address> closed;
+  std::vector<Ipv4Address> dropped;
+  typedef std::unordered_multimap<uint64_t, uint32_t>::const_iterator Iterator;
+  std::pair<Iterator, Iterator> range = m_macIndex.equal_range (GetMacKey (addr));
+  for (Iterator i = range.first; i != range.second; ++i)
     {
-      if (i->m_hardwareAddress == addr)
+      Neighbor & neighbor = m_nb.find (i->second)->second;
+      // The last attempt of the frame failed as well
+      UpdateLinkQuality (neighbor, 1, false);
+      ++neighbor.m_txErrors;
+      if (neighbor.m_txErrors >= m_maxTxErrors || neighbor.m_linkQuality < m_linkQualityThreshold)
         {
-          i->close = true;
+          closed.push_back (neighbor.m_neighborAddress);
         }
+      else
+        {
+          dropped.push_back (neighbor.m_neighborAddress);
+        }
+    }
+  CloseLinks (closed);
+  if (!m_handleTxStatus.IsNull ())
+    {
+      for (std::vector<Ipv4Address>::const_iterator j = dropped.begin (); j != dropped.end (); ++j)
+        {
+          m_handleTxStatus (*j, false);
+        }
+    }
+}
+
+void
+Neighbors::ProcessTxOk (WifiMacHeader const & hdr)
+{
+  typedef std::unordered_multimap<uint64_t, uint32_t>::const_iterator Iterator;
+  std::pair<Iterator, Iterator> range = m_macIndex.equal_range (GetMacKey (hdr.GetAddr1 ()));
+  for (Iterator i = range.first; i != range.second; ++i)
+    {
+      Neighbor & neighbor = m_nb.find (i->second)->second;
+      neighbor.m_txErrors = 0;
+      // Failed attempts before the acknowledgment were reported by ProcessTxDataFailed
+      UpdateLinkQuality (neighbor, 0, true);
+      if (!m_handleTxStatus.IsNull ())
+        {
+          m_handleTxStatus (neighbor.m_neighborAddress, true);
+        }
+    }
+}
+
+void
+Neighbors::ProcessTxDataFailed (Mac48Address addr)
+{
+  typedef std::unordered_multimap<uint64_t, uint32_t>::const_iterator Iterator;
+  std::pair<Iterator, Iterator> range = m_macIndex.equal_range (GetMacKey (addr));
+  for (Iterator i = range.first; i != range.second; ++i)
+    {
+      UpdateLinkQuality (m_nb.find (i->second)->second, 1, false);
+    }
+}
+
+double
+Neighbors::GetLinkQuality (Ipv4Address addr) const
+{
+  std::unordered_map<uint32_t, Neighbor>::const_iterator i = m_nb.find (addr.Get ());
+  return i == m_nb.end () ? 1 : i->second.m_linkQuality;
+}
+
+void
+Neighbors::UpdateLinkQuality (Neighbor & neighbor, uint32_t failures, bool delivered)
+{
+  if (m_linkQualityWeight <= 0)
+    {
+      return;
+    }
+  double quality = neighbor.m_linkQuality;
+  for (uint32_t k = 0; k < failures; ++k)
+    {
+      quality -= m_linkQualityWeight * quality;
+    }
+  if (delivered)
+    {
+      quality += m_linkQualityWeight * (1 - quality);
+    }
+  neighbor.m_linkQuality = quality;
+  ReportLinkQuality (neighbor, quality);
+}
+
+void
+Neighbors::ReportLinkQuality (Neighbor & neighbor, double quality)
+{
+  // Reporting updates every route through the neighbor, so do not report every frame
+  const double step = 0.05;
+  if (std::fabs (quality - neighbor.m_reportedQuality) < step
+      && (quality < 1 || neighbor.m_reportedQuality == 1))
+    {
+      return;
+    }
+  neighbor.m_reportedQuality = quality;
+  if (!m_handleLinkQuality.IsNull ())
+    {
+      m_handleLinkQuality (neighbor.m_neighborAddress, quality);
     }
-  Purge ();
 }
 
 }  // namespace aodv
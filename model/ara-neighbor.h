@@ -30,6 +30,8 @@
 #define ARANEIGHBOR_H
 
 #include <vector>
+#include <queue>
+#include <unordered_map>
 #include "ns3/simulator.h"
 #include "ns3/timer.h"
 #include "ns3/ipv4-address.h"
@@ -47,13 +49,32 @@ class RoutingProtocol;
 /**
  * \ingroup ara
  * \brief maintain list of active neighbors
+ *
+ * Neighbors are indexed by IPv4 address and by MAC address, once known.
+ * Expired neighbors are treated as absent and removed when the timer fires.
+ * The timer is armed for the earliest neighbor deadline only, rounded up
+ * to the purge granularity so that neighbors expiring close together are
+ * removed by a single timer event.
+ *
+ * Layer 2 feedback keeps an estimate of the delivery ratio of the link to
+ * each neighbor, an exponentially weighted moving average over transmission
+ * attempts.  Each attempt the remote station manager reports as failed, an
+ * acknowledged frame and a frame dropped after its last retry all count as
+ * one attempt, so the real retry count of a frame enters the estimate.
+ * Changes of the estimate are reported through the link quality callback
+ * once they exceed a fixed step.  The link is closed once a number of frames
+ * in a row were dropped or the estimate falls below a threshold; other
+ * acknowledged and dropped frames are reported through the TX status
+ * callback.  Received
+ * signal strength is not used: the estimate only follows the outcome of
+ * transmissions, which is what the pheromone it scales has to predict.
  */
 class Neighbors
 {
 public:
   /**
    * constructor
-   * \param delay the delay time for purging the list of neighbors
+   * \param delay the granularity of purging the list of neighbors
    */
   Neighbors (Time delay);
   /// Neighbor description
@@ -65,8 +86,14 @@ public:
     Mac48Address m_hardwareAddress;
     /// Neighbor expire time
     Time m_expireTime;
-    /// Neighbor close indicator
-    bool close;
+    /// Number of frames to the neighbor dropped in a row by the MAC
+    uint32_t m_txErrors;
+    /// Deadline of the expiry index record of the neighbor
+    Time m_indexedExpiry;
+    /// Estimated delivery ratio of the link to the neighbor
+    double m_linkQuality;
+    /// Delivery ratio last reported through the link quality callback
+    double m_reportedQuality;
 
     /**
      * \brief Neighbor structure constructor
@@ -79,7 +106,10 @@ public:
       : m_neighborAddress (ip),
         m_hardwareAddress (mac),
         m_expireTime (t),
-        close (false)
+        m_txErrors (0),
+        m_indexedExpiry (t),
+        m_linkQuality (1),
+        m_reportedQuality (1)
     {
     }
   };
@@ -101,14 +131,30 @@ public:
    * \param expire the expire time for the address
    */
   void Update (Ipv4Address addr, Time expire);
+  /**
+   * Update expire time for two neighbors, adding the missing ones
+   * \param first the IP address of the first neighbor
+   * \param second the IP address of the second neighbor
+   * \param expire the expire time for the addresses
+   */
+  void Update (Ipv4Address first, Ipv4Address second, Time expire);
   /// Remove all expired entries
   void Purge ();
-  /// Schedule m_ntimer.
+  /// Schedule m_ntimer for the earliest neighbor deadline rounded up to the granularity, unless it already is.
   void ScheduleTimer ();
   /// Remove all entries
   void Clear ()
   {
     m_nb.clear ();
+    m_macIndex.clear ();
+    m_expiryIndex = ExpiryIndex ();
+  }
+  /**
+   * \returns the number of times m_ntimer was scheduled
+   */
+  uint64_t GetTimerEvents () const
+  {
+    return m_timerEvents;
   }
 
   /**
@@ -129,6 +175,98 @@ public:
   {
     return m_txErrorCallback;
   }
+  /**
+   * Get callback to ProcessTxOk
+   * \returns the callback function
+   */
+  Callback<void, WifiMacHeader const &> GetTxOkCallback () const
+  {
+    return m_txOkCallback;
+  }
+  /**
+   * Get callback to ProcessTxDataFailed, for the MacTxDataFailed trace of
+   * the Wi-Fi remote station manager
+   * \returns the callback function
+   */
+  Callback<void, Mac48Address> GetTxDataFailedCallback () const
+  {
+    return m_txDataFailedCallback;
+  }
+  /**
+   * Get the estimated delivery ratio of the link to a neighbor
+   * \param addr the IP address of the neighbor
+   * \returns the delivery ratio, 1 if there is no such neighbor or no feedback yet
+   */
+  double GetLinkQuality (Ipv4Address addr) const;
+  /**
+   * Set the weight of a new transmission attempt in the delivery ratio
+   * estimate, 0 disables the estimate
+   * \param weight the weight, in [0, 1]
+   */
+  void SetLinkQualityWeight (double weight)
+  {
+    m_linkQualityWeight = weight;
+  }
+  /**
+   * \returns the weight of a new transmission attempt in the delivery ratio estimate
+   */
+  double GetLinkQualityWeight () const
+  {
+    return m_linkQualityWeight;
+  }
+  /**
+   * Set the number of frames to a neighbor the MAC may drop in a row before
+   * the link to it is closed
+   * \param errors the number of frames, at least 1
+   */
+  void SetMaxTxErrors (uint32_t errors)
+  {
+    m_maxTxErrors = errors;
+  }
+  /**
+   * \returns the number of frames to a neighbor the MAC may drop in a row
+   */
+  uint32_t GetMaxTxErrors () const
+  {
+    return m_maxTxErrors;
+  }
+  /**
+   * Set the delivery ratio estimate below which a frame dropped by the MAC
+   * closes the link
+   * \param threshold the delivery ratio, 0 disables closing on the estimate
+   */
+  void SetLinkQualityThreshold (double threshold)
+  {
+    m_linkQualityThreshold = threshold;
+  }
+  /**
+   * \returns the delivery ratio estimate below which a frame dropped by the MAC closes the link
+   */
+  double GetLinkQualityThreshold () const
+  {
+    return m_linkQualityThreshold;
+  }
+  /**
+   * Set link quality callback, invoked with the neighbor address and its
+   * new delivery ratio estimate
+   * \param cb the callback function
+   */
+  void SetLinkQualityCallback (Callback<void, Ipv4Address, double> cb)
+  {
+    m_handleLinkQuality = cb;
+  }
+
+  /**
+   * Set TX status callback, invoked with the neighbor address and whether a
+   * frame to it was delivered, after a frame was acknowledged or dropped
+   * after its last retry.  A drop that closes the link is reported through
+   * the link failure callback only.
+   * \param cb the callback function
+   */
+  void SetTxStatusCallback (Callback<void, Ipv4Address, bool> cb)
+  {
+    m_handleTxStatus = cb;
+  }
 
   /**
    * Set link failure callback
@@ -152,10 +290,42 @@ private:
   Callback<void, Ipv4Address> m_handleLinkFailure;
   /// TX error callback
   Callback<void, WifiMacHeader const &> m_txErrorCallback;
+  /// TX success callback
+  Callback<void, WifiMacHeader const &> m_txOkCallback;
+  /// TX attempt failure callback
+  Callback<void, Mac48Address> m_txDataFailedCallback;
+  /// link quality callback
+  Callback<void, Ipv4Address, double> m_handleLinkQuality;
+  /// TX status callback
+  Callback<void, Ipv4Address, bool> m_handleTxStatus;
   /// Timer for neighbor's list. Schedule Purge().
   Timer m_ntimer;
-  /// vector of entries
-  std::vector<Neighbor> m_nb;
+  /// Granularity of the expiry times of m_ntimer
+  Time m_granularity;
+  /// Expiry time m_ntimer is scheduled for
+  Time m_timerExpiry;
+  /// Number of times m_ntimer was scheduled
+  uint64_t m_timerEvents;
+  /// Weight of a new transmission attempt in the delivery ratio estimate
+  double m_linkQualityWeight;
+  /// Number of frames to a neighbor the MAC may drop in a row before the link is closed
+  uint32_t m_maxTxErrors;
+  /// Delivery ratio estimate below which a frame dropped by the MAC closes the link
+  double m_linkQualityThreshold;
+  /// Expiry index record: neighbor deadline and address
+  typedef std::pair<Time, Ipv4Address> ExpiryRecord;
+  /// Min-heap of expiry index records, earliest deadline on top
+  typedef std::priority_queue<ExpiryRecord, std::vector<ExpiryRecord>, std::greater<ExpiryRecord> > ExpiryIndex;
+  /**
+   * Expiry index, one live record per neighbor.  A record is stale if its
+   * deadline differs from the neighbor's m_indexedExpiry.  Neighbors whose
+   * expire time moved later are pushed again when their record is popped.
+   */
+  ExpiryIndex m_expiryIndex;
+  /// entries, keyed by IPv4 address
+  std::unordered_map<uint32_t, Neighbor> m_nb;
+  /// IPv4 addresses of the entries with a known MAC address, keyed by MAC address
+  std::unordered_multimap<uint64_t, uint32_t> m_macIndex;
   /// list of ARP cached to be used for layer 2 notifications processing
   std::vector<Ptr<ArpCache> > m_arp;
 
@@ -166,8 +336,42 @@ private:
    * \returns the MAC address for the IP address
    */
   Mac48Address LookupMacAddress (Ipv4Address addr);
-  /// Process layer 2 TX error notification
+  /**
+   * \param addr the MAC address
+   * \returns the key of the MAC address in the MAC index
+   */
+  static uint64_t GetMacKey (Mac48Address addr);
+  /**
+   * Set the MAC address of an entry and index it
+   * \param neighbor the entry
+   * \param addr the MAC address
+   */
+  void SetHardwareAddress (Neighbor & neighbor, Mac48Address addr);
+  /**
+   * Remove entries and notify link failures
+   * \param addresses the IP addresses of the entries
+   */
+  void CloseLinks (std::vector<Ipv4Address> & addresses);
+  /// Process layer 2 TX error notification: a frame was dropped after its last retry
   void ProcessTxError (WifiMacHeader const &);
+  /// Process layer 2 TX success notification
+  void ProcessTxOk (WifiMacHeader const &);
+  /// Process layer 2 notification of a failed transmission attempt that will be retried
+  void ProcessTxDataFailed (Mac48Address addr);
+  /**
+   * Add transmission attempts to the link to a neighbor to its delivery ratio estimate
+   * \param neighbor the entry
+   * \param failures the number of failed attempts
+   * \param delivered whether the last attempt succeeded
+   */
+  void UpdateLinkQuality (Neighbor & neighbor, uint32_t failures, bool delivered);
+  /**
+   * Report the delivery ratio estimate of a neighbor if it moved far enough
+   * from the value reported last
+   * \param neighbor the entry
+   * \param quality the delivery ratio estimate
+   */
+  void ReportLinkQuality (Neighbor & neighbor, double quality);
 };
 
 }  // namespace aodv
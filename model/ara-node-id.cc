@@ -0,0 +1,295 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ara-node-id.h"
+#include "ns3/simulator.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+namespace ara {
+
+const NodeId NodeIdMap::NONE;
+const uint32_t NodeIdSet::INLINE_SIZE;
+
+NodeId
+NodeIdMap::Intern (Ipv4Address addr)
+{
+  State & state = GetState ();
+  std::unordered_map<uint32_t, NodeId>::const_iterator i = state.m_ids.find (addr.Get ());
+  if (i != state.m_ids.end ())
+    {
+      return i->second;
+    }
+  if (!state.m_resetScheduled)
+    {
+      Simulator::ScheduleDestroy (&NodeIdMap::Reset);
+      state.m_resetScheduled = true;
+    }
+  NodeId id = state.m_addresses.size ();
+  state.m_ids.insert (std::make_pair (addr.Get (), id));
+  state.m_addresses.push_back (addr);
+  return id;
+}
+
+NodeId
+NodeIdMap::Lookup (Ipv4Address addr)
+{
+  State const & state = GetState ();
+  std::unordered_map<uint32_t, NodeId>::const_iterator i = state.m_ids.find (addr.Get ());
+  return (i == state.m_ids.end ()) ? NONE : i->second;
+}
+
+Ipv4Address
+NodeIdMap::GetAddress (NodeId id)
+{
+  State const & state = GetState ();
+  NS_ASSERT (id < state.m_addresses.size ());
+  return state.m_addresses[id];
+}
+
+uint32_t
+NodeIdMap::GetSize ()
+{
+  return GetState ().m_addresses.size ();
+}
+
+uint32_t
+NodeIdMap::GetGeneration ()
+{
+  return GetState ().m_generation;
+}
+
+void
+NodeIdMap::Reset ()
+{
+  State & state = GetState ();
+  state.m_ids.clear ();
+  state.m_addresses.clear ();
+  ++state.m_generation;
+  state.m_resetScheduled = false;
+}
+
+NodeIdMap::State &
+NodeIdMap::GetState ()
+{
+  static State state;
+  return state;
+}
+
+NodeIdSet::NodeIdSet ()
+  : m_inlineSize (0),
+    m_generation (NodeIdMap::GetGeneration ())
+{
+}
+
+bool
+NodeIdSet::Insert (NodeId id)
+{
+  NS_ASSERT (id != NodeIdMap::NONE);
+  MakeCurrent ();
+  if (!m_bits.empty ())
+    {
+      return SetBit (id);
+    }
+  if (Contains (id))
+    {
+      return false;
+    }
+  if (m_inlineSize == INLINE_SIZE)
+    {
+      Grow ();
+      return SetBit (id);
+    }
+  m_inline[m_inlineSize++] = id;
+  return true;
+}
+
+bool
+NodeIdSet::Contains (NodeId id) const
+{
+  if (!IsCurrent ())
+    {
+      return false;
+    }
+  if (!m_bits.empty ())
+    {
+      uint32_t word = id / 64;
+      return word < m_bits.size () && (m_bits[word] >> (id % 64)) & 1;
+    }
+  for (uint32_t i = 0; i < m_inlineSize; ++i)
+    {
+      if (m_inline[i] == id)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+bool
+NodeIdSet::Erase (NodeId id)
+{
+  MakeCurrent ();
+  if (!m_bits.empty ())
+    {
+      if (!Contains (id))
+        {
+          return false;
+        }
+      m_bits[id / 64] &= ~(uint64_t (1) << (id % 64));
+      return true;
+    }
+  for (uint32_t i = 0; i < m_inlineSize; ++i)
+    {
+      if (m_inline[i] == id)
+        {
+          m_inline[i] = m_inline[--m_inlineSize];
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+NodeIdSet::Clear ()
+{
+  m_inlineSize = 0;
+  m_bits.clear ();
+  m_generation = NodeIdMap::GetGeneration ();
+}
+
+bool
+NodeIdSet::IsEmpty () const
+{
+  return GetSize () == 0;
+}
+
+uint32_t
+NodeIdSet::GetSize () const
+{
+  if (!IsCurrent ())
+    {
+      return 0;
+    }
+  if (m_bits.empty ())
+    {
+      return m_inlineSize;
+    }
+  uint32_t size = 0;
+  for (std::vector<uint64_t>::const_iterator i = m_bits.begin (); i != m_bits.end (); ++i)
+    {
+      for (uint64_t word = *i; word != 0; word &= word - 1)
+        {
+          ++size;
+        }
+    }
+  return size;
+}
+
+void
+NodeIdSet::Union (NodeIdSet const & other)
+{
+  MakeCurrent ();
+  if (!other.IsCurrent ())
+    {
+      return;
+    }
+  if (other.m_bits.empty ())
+    {
+      for (uint32_t i = 0; i < other.m_inlineSize; ++i)
+        {
+          Insert (other.m_inline[i]);
+        }
+      return;
+    }
+  Grow ();
+  if (m_bits.size () < other.m_bits.size ())
+    {
+      m_bits.resize (other.m_bits.size (), 0);
+    }
+  for (uint32_t i = 0; i < other.m_bits.size (); ++i)
+    {
+      m_bits[i] |= other.m_bits[i];
+    }
+}
+
+void
+NodeIdSet::GetAddresses (std::vector<Ipv4Address> & addresses) const
+{
+  if (!IsCurrent ())
+    {
+      return;
+    }
+  if (m_bits.empty ())
+    {
+      for (uint32_t i = 0; i < m_inlineSize; ++i)
+        {
+          addresses.push_back (NodeIdMap::GetAddress (m_inline[i]));
+        }
+      return;
+    }
+  for (uint32_t word = 0; word < m_bits.size (); ++word)
+    {
+      for (uint32_t bit = 0; bit < 64; ++bit)
+        {
+          if ((m_bits[word] >> bit) & 1)
+            {
+              addresses.push_back (NodeIdMap::GetAddress (word * 64 + bit));
+            }
+        }
+    }
+}
+
+void
+NodeIdSet::MakeCurrent ()
+{
+  if (!IsCurrent ())
+    {
+      Clear ();
+    }
+}
+
+void
+NodeIdSet::Grow ()
+{
+  if (!m_bits.empty ())
+    {
+      return;
+    }
+  // Size the bitset for all IDs handed out so far, so that it rarely grows again
+  m_bits.assign (NodeIdMap::GetSize () / 64 + 1, 0);
+  for (uint32_t i = 0; i < m_inlineSize; ++i)
+    {
+      SetBit (m_inline[i]);
+    }
+  m_inlineSize = 0;
+}
+
+bool
+NodeIdSet::SetBit (NodeId id)
+{
+  uint32_t word = id / 64;
+  if (word >= m_bits.size ())
+    {
+      m_bits.resize (word + 1, 0);
+    }
+  uint64_t mask = uint64_t (1) << (id % 64);
+  bool added = (m_bits[word] & mask) == 0;
+  m_bits[word] |= mask;
+  return added;
+}
+
+}  // namespace ara
+}  // namespace ns3
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ARA_NODE_ID_H
+#define ARA_NODE_ID_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+namespace ara {
+
+/// Dense index of an IPv4 address, shared by all ARA tables of a simulation
+typedef uint32_t NodeId;
+
+/**
+ * \ingroup ara
+ * \brief Interning of IPv4 addresses into dense node IDs
+ *
+ * Each address is given the next free NodeId the first time it is interned,
+ * so that tables can hold per-node state in flat arrays indexed by NodeId.
+ * IDs are shared by every ARA instance of the simulation and are reused
+ * after Simulator::Destroy; tables that outlive a simulation detect this
+ * through GetGeneration and rebuild their indexes.
+ *
+ * Only the routing table and the precursor sets are indexed by NodeId.  The
+ * neighbor table, IdCache, RequestQueue and DuplicatePacketDetection hash the
+ * address directly: they are looked up by address, and resolving an address
+ * to its ID is itself a hash probe, so a NodeId key would not save one.
+ */
+class NodeIdMap
+{
+public:
+  /// ID of an address that has not been interned
+  static const NodeId NONE = 0xffffffff;
+  /**
+   * Get the ID of an address, assigning a new one if needed
+   * \param addr the IP address
+   * \returns the ID
+   */
+  static NodeId Intern (Ipv4Address addr);
+  /**
+   * Get the ID of an address without assigning one
+   * \param addr the IP address
+   * \returns the ID, or NONE if the address has not been interned
+   */
+  static NodeId Lookup (Ipv4Address addr);
+  /**
+   * Get the address of an ID
+   * \param id the ID
+   * \returns the IP address
+   */
+  static Ipv4Address GetAddress (NodeId id);
+  /**
+   * \returns the number of interned addresses; all IDs are below it
+   */
+  static uint32_t GetSize ();
+  /**
+   * \returns the number of times the IDs have been reset
+   */
+  static uint32_t GetGeneration ();
+
+private:
+  /// Forget all IDs at the end of the simulation
+  static void Reset ();
+  /// Interned addresses of the simulation
+  struct State
+  {
+    State () : m_generation (0), m_resetScheduled (false)
+    {
+    }
+    /// ID of each interned address, keyed by its 32-bit value
+    std::unordered_map<uint32_t, NodeId> m_ids;
+    /// Address of each ID
+    std::vector<Ipv4Address> m_addresses;
+    /// Number of resets so far
+    uint32_t m_generation;
+    /// Whether Reset is scheduled for Simulator::Destroy
+    bool m_resetScheduled;
+  };
+  /// \returns the interned addresses
+  static State & GetState ();
+};
+
+/**
+ * \ingroup ara
+ * \brief Set of node IDs
+ *
+ * Small sets are kept in an inline array; a set that outgrows it becomes a
+ * bitset over node IDs, so that unions cost one word operation per 64 IDs.
+ * A set left over from an earlier simulation reads as empty.
+ */
+class NodeIdSet
+{
+public:
+  NodeIdSet ();
+  /**
+   * Add a node ID
+   * \param id the node ID
+   * \returns true if it was not in the set
+   */
+  bool Insert (NodeId id);
+  /**
+   * \param id the node ID
+   * \returns true if the ID is in the set
+   */
+  bool Contains (NodeId id) const;
+  /**
+   * Remove a node ID
+   * \param id the node ID
+   * \returns true if it was in the set
+   */
+  bool Erase (NodeId id);
+  /// Remove all node IDs
+  void Clear ();
+  /// \returns true if the set is empty
+  bool IsEmpty () const;
+  /// \returns the number of node IDs in the set
+  uint32_t GetSize () const;
+  /**
+   * Add all node IDs of another set
+   * \param other the other set
+   */
+  void Union (NodeIdSet const & other);
+  /**
+   * Append the addresses of the node IDs in the set, in ID order
+   * \param addresses the vector to append to
+   */
+  void GetAddresses (std::vector<Ipv4Address> & addresses) const;
+
+private:
+  /// Number of node IDs kept inline before switching to a bitset
+  static const uint32_t INLINE_SIZE = 4;
+  /// \returns true if the set belongs to the current NodeIdMap generation
+  bool IsCurrent () const
+  {
+    return m_generation == NodeIdMap::GetGeneration ();
+  }
+  /// Empty a set left over from an earlier NodeIdMap generation
+  void MakeCurrent ();
+  /// Move the inline node IDs into the bitset
+  void Grow ();
+  /**
+   * Set a bit, growing the bitset as needed
+   * \param id the node ID
+   * \returns true if the bit was clear
+   */
+  bool SetBit (NodeId id);
+  /// Inline node IDs, used while m_bits is empty
+  NodeId m_inline[INLINE_SIZE];
+  /// Number of inline node IDs
+  uint32_t m_inlineSize;
+  /// Bitset over node IDs, empty while the set is inline
+  std::vector<uint64_t> m_bits;
+  /// NodeIdMap generation of the node IDs
+  uint32_t m_generation;
+};
+
+}  // namespace ara
+}  // namespace ns3
+
+#endif /* ARA_NODE_ID_H */
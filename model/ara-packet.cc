@@ -303,7 +303,8 @@ BANTHeader::BANTHeader (uint8_t prefixSize, uint8_t hopCount, Ipv4Address dst,
     m_hopCount (hopCount),
     m_dst (dst),
     m_dstSeqNo (dstSeqNo),
-    m_origin (origin)
+    m_origin (origin),
+    m_fantId (0)
 {
   m_lifeTime = uint32_t (lifeTime.GetMilliSeconds ());
 }
@@ -330,7 +331,7 @@ BANTHeader::GetInstanceTypeId () const
 uint32_t
 BANTHeader::GetSerializedSize () const
 {
-  return 19;
+  return (m_flags & (1 << 5)) ? 23 : 19;
 }
 
 void
@@ -343,6 +344,10 @@ BANTHeader::Serialize (Buffer::Iterator i) const
   i.WriteHtonU32 (m_dstSeqNo);
   WriteTo (i, m_origin);
   i.WriteHtonU32 (m_lifeTime);
+  if (m_flags & (1 << 5))
+    {
+      i.WriteHtonU32 (m_fantId);
+    }
 }
 
 uint32_t
@@ -357,6 +362,7 @@ BANTHeader::Deserialize (Buffer::Iterator start)
   m_dstSeqNo = i.ReadNtohU32 ();
   ReadFrom (i, m_origin);
   m_lifeTime = i.ReadNtohU32 ();
+  m_fantId = (m_flags & (1 << 5)) ? i.ReadNtohU32 () : 0;
 
   uint32_t dist = i.GetDistanceFrom (start);
   NS_ASSERT (dist == GetSerializedSize ());
@@ -373,6 +379,10 @@ BANTHeader::Print (std::ostream &os) const
     }
   os << " source ipv4 " << m_origin << " lifetime " << m_lifeTime
      << " acknowledgment required flag " << (*this).GetAckRequired ();
+  if (m_flags & (1 << 5))
+    {
+      os << " FANT ID " << m_fantId;
+    }
 }
 
 void
@@ -407,6 +417,20 @@ BANTHeader::GetAckRequired () const
   return (m_flags & (1 << 6));
 }
 
+void
+BANTHeader::SetFantId (uint32_t id)
+{
+  m_fantId = id;
+  if (id != 0)
+    {
+      m_flags |= (1 << 5);
+    }
+  else
+    {
+      m_flags &= ~(1 << 5);
+    }
+}
+
 void
 BANTHeader::SetPrefixSize (uint8_t sz)
 {
@@ -424,7 +448,8 @@ BANTHeader::operator== (BANTHeader const & o) const
 {
   return (m_flags == o.m_flags && m_prefixSize == o.m_prefixSize
           && m_hopCount == o.m_hopCount && m_dst == o.m_dst && m_dstSeqNo == o.m_dstSeqNo
-          && m_origin == o.m_origin && m_lifeTime == o.m_lifeTime);
+          && m_origin == o.m_origin && m_lifeTime == o.m_lifeTime
+          && m_fantId == o.m_fantId);
 }
 
 void
@@ -437,6 +462,7 @@ BANTHeader::SetHello (Ipv4Address origin, uint32_t srcSeqNo, Time lifetime)
   m_dstSeqNo = srcSeqNo;
   m_origin = origin;
   m_lifeTime = lifetime.GetMilliSeconds ();
+  m_fantId = 0;
 }
 
 std::ostream &
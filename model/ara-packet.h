@@ -320,9 +320,7 @@ std::ostream & operator<< (std::ostream & os, FANTHeader const &);
   0                   1                   2                   3
   0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-  |     Type      |J|R|G|D|U|   Reserved          |   Pheromone   |
-  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-  |                            BANT ID                            |
+  |     Type      | |A|F|Reserved |  Prefix Size  |   Hop Count   |
   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
   |                    Destination IP Address                     |
   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -330,7 +328,9 @@ std::ostream & operator<< (std::ostream & os, FANTHeader const &);
   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
   |                    Originator IP Address                      |
   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-  |                  Originator Sequence Number                   |
+  |                           Lifetime                            |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |                     FANT ID (only if F set)                   |
   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
   \endverbatim
 */
@@ -448,6 +448,24 @@ public:
    * \return the ack required flag
    */
   bool GetAckRequired () const;
+  /**
+   * \brief Set the ID of the FANT answered, 0 if none
+   *
+   * A non-zero ID sets the F flag, which adds the 4-byte FANT ID field to
+   * the serialized header; 0 clears it.
+   *
+   * \param id the FANT ID
+   */
+  void SetFantId (uint32_t id);
+  /**
+   * \brief Get the ID of the FANT answered
+   * \return the FANT ID, 0 if none
+   */
+  uint32_t GetFantId () const
+  {
+    return m_fantId;
+  }
+
   /**
    * \brief Set the prefix size
    * \param sz the prefix size
@@ -475,13 +493,14 @@ public:
    */
   bool operator== (BANTHeader const & o) const;
 private:
-  uint8_t       m_flags;                  ///< A - acknowledgment required flag
+  uint8_t       m_flags;                  ///< A - acknowledgment required flag, F - FANT ID present
   uint8_t       m_prefixSize;         ///< Prefix Size
   uint8_t             m_hopCount;         ///< Hop Count
   Ipv4Address   m_dst;              ///< Destination IP Address
   uint32_t      m_dstSeqNo;         ///< Destination Sequence Number
   Ipv4Address     m_origin;           ///< Source IP Address
   uint32_t      m_lifeTime;         ///< Lifetime (in milliseconds)
+  uint32_t      m_fantId;           ///< ID of the FANT answered, 0 if none
 };
 
 /**
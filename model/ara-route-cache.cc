@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "ara-route-cache.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AraRouteCache");
+
+namespace ara {
+
+RouteCache::RouteCache (uint32_t size, Time refreshInterval)
+  : m_slots (size),
+    m_used (0),
+    m_refreshInterval (refreshInterval)
+{
+}
+
+void
+RouteCache::SetSize (uint32_t size)
+{
+  m_slots.assign (size, Slot ());
+  m_used = 0;
+}
+
+Ptr<Ipv4Route>
+RouteCache::Lookup (Ipv4Address dst, Ptr<NetDevice> oif, uint32_t flowHash)
+{
+  if (m_used == 0)
+    {
+      return 0;
+    }
+  Slot & slot = GetSlot (dst, oif, flowHash);
+  if (slot.m_route == 0 || slot.m_dst != dst || slot.m_oif != oif || slot.m_flowHash != flowHash)
+    {
+      return 0;
+    }
+  if (slot.m_validUntil <= Simulator::Now ())
+    {
+      NS_LOG_LOGIC ("Cached route to " << dst << " is due for a refresh or expired");
+      return 0;
+    }
+  return slot.m_route;
+}
+
+void
+RouteCache::Insert (Ipv4Address dst, Ptr<NetDevice> oif, uint32_t flowHash, Ptr<Ipv4Route> route, Time expire)
+{
+  if (m_slots.empty ())
+    {
+      return;
+    }
+  Slot & slot = GetSlot (dst, oif, flowHash);
+  if (slot.m_route == 0)
+    {
+      ++m_used;
+    }
+  slot.m_dst = dst;
+  slot.m_oif = oif;
+  slot.m_flowHash = flowHash;
+  slot.m_route = route;
+  slot.m_validUntil = std::min (Simulator::Now () + m_refreshInterval, expire);
+}
+
+void
+RouteCache::Invalidate (Ipv4Address dst)
+{
+  if (m_used == 0)
+    {
+      return;
+    }
+  if (dst == Ipv4Address::GetAny ())
+    {
+      Clear ();
+      return;
+    }
+  for (std::vector<Slot>::iterator i = m_slots.begin (); i != m_slots.end (); ++i)
+    {
+      if (i->m_route != 0 && i->m_dst == dst)
+        {
+          NS_LOG_LOGIC ("Drop cached route to " << dst);
+          i->m_route = 0;
+          i->m_oif = 0;
+          --m_used;
+        }
+    }
+}
+
+void
+RouteCache::Clear ()
+{
+  SetSize (m_slots.size ());
+}
+
+uint32_t
+RouteCache::GetFlowHash (Ipv4Header const & header)
+{
+  return (header.GetSource ().Get () * 2654435761u) ^ (header.GetProtocol () << 8) ^ header.GetTos ();
+}
+
+RouteCache::Slot &
+RouteCache::GetSlot (Ipv4Address dst, Ptr<NetDevice> oif, uint32_t flowHash)
+{
+  uint32_t h = dst.Get () * 2654435761u;
+  h ^= flowHash + 0x9e3779b9u + (h << 6) + (h >> 2);
+  if (oif != 0)
+    {
+      h ^= oif->GetIfIndex () + 0x9e3779b9u + (h << 6) + (h >> 2);
+    }
+  return m_slots[h % m_slots.size ()];
+}
+
+}  // namespace ara
+}  // namespace ns3
@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef ARA_ROUTE_CACHE_H
+#define ARA_ROUTE_CACHE_H
+
+#include <vector>
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/net-device.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+namespace ara {
+
+/**
+ * \ingroup ara
+ * \brief Direct-mapped cache of the routes chosen for locally originated flows
+ *
+ * A slot is keyed on destination, output device and flow hash and holds the
+ * route last chosen for the flow. Slots of a destination are dropped when the
+ * routing table reports a change of the route to it, see
+ * RoutingTable::SetRouteChangeCallback. A slot is only used until the routing
+ * table entry it was filled from expires, or until the lifetime of the route is
+ * due for a refresh once per refresh interval, whichever is earlier; lookups
+ * after that miss, so that the routing table sees the entry again.
+ */
+class RouteCache
+{
+public:
+  /**
+   * constructor
+   * \param size the number of slots, zero disables the cache
+   * \param refreshInterval the interval between lifetime refreshes of a cached route
+   */
+  RouteCache (uint32_t size, Time refreshInterval);
+  /**
+   * Look up the route of a flow
+   * \param dst the destination
+   * \param oif the requested output device, may be 0
+   * \param flowHash the flow hash, see GetFlowHash
+   * \returns the cached route, or 0 on a miss or if the route is due for a refresh or expired
+   */
+  Ptr<Ipv4Route> Lookup (Ipv4Address dst, Ptr<NetDevice> oif, uint32_t flowHash);
+  /**
+   * Cache the route of a flow whose lifetime has just been refreshed
+   * \param dst the destination
+   * \param oif the requested output device, may be 0
+   * \param flowHash the flow hash, see GetFlowHash
+   * \param route the route
+   * \param expire the time the routing table entry of the route expires
+   */
+  void Insert (Ipv4Address dst, Ptr<NetDevice> oif, uint32_t flowHash, Ptr<Ipv4Route> route, Time expire);
+  /**
+   * Drop all cached routes to a destination
+   * \param dst the destination, or the any address to drop every route
+   */
+  void Invalidate (Ipv4Address dst);
+  /// Drop all cached routes
+  void Clear ();
+  /**
+   * Hash of the flow a packet belongs to
+   * \param header the IP header of the packet
+   * \returns the flow hash
+   */
+  static uint32_t GetFlowHash (Ipv4Header const & header);
+  ///\name Handle the number of slots
+  //\{
+  uint32_t GetSize () const
+  {
+    return m_slots.size ();
+  }
+  void SetSize (uint32_t size);
+  //\}
+  ///\name Handle the lifetime refresh interval
+  //\{
+  Time GetRefreshInterval () const
+  {
+    return m_refreshInterval;
+  }
+  void SetRefreshInterval (Time t)
+  {
+    m_refreshInterval = t;
+  }
+  //\}
+
+private:
+  /// Cache slot
+  struct Slot
+  {
+    /// Destination
+    Ipv4Address m_dst;
+    /// Requested output device
+    Ptr<NetDevice> m_oif;
+    /// Flow hash
+    uint32_t m_flowHash;
+    /// Cached route, 0 if the slot is empty
+    Ptr<Ipv4Route> m_route;
+    /// When the slot stops being used: the next lifetime refresh of the route or its expiry, whichever is earlier
+    Time m_validUntil;
+  };
+  /**
+   * Slot of a flow
+   * \param dst the destination
+   * \param oif the requested output device
+   * \param flowHash the flow hash
+   * \returns the slot
+   */
+  Slot & GetSlot (Ipv4Address dst, Ptr<NetDevice> oif, uint32_t flowHash);
+  /// Slots
+  std::vector<Slot> m_slots;
+  /// Number of slots in use
+  uint32_t m_used;
+  /// Interval between lifetime refreshes of a cached route
+  Time m_refreshInterval;
+};
+
+}  // namespace ara
+}  // namespace ns3
+
+#endif /* ARA_ROUTE_CACHE_H */
@@ -31,6 +31,8 @@
 #include "ara-routing-protocol.h"
 #include "ns3/log.h"
 #include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/trace-source-accessor.h"
@@ -39,6 +41,7 @@
 #include "ns3/udp-header.h"
 #include "ns3/wifi-net-device.h"
 #include "ns3/adhoc-wifi-mac.h"
+#include "ns3/wifi-remote-station-manager.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
 #include <algorithm>
@@ -158,24 +161,62 @@ RoutingProtocol::RoutingProtocol ()
     m_blackListTimeout (Time (m_rreqRetries * m_netTraversalTime)),
     m_maxQueueLen (64),
     m_maxQueueTime (Seconds (30)),
+    m_maxQueueBytes (0),
+    m_maxQueueLenPerDst (0),
     m_destinationOnly (false),
     m_gratuitousReply (true),
     m_enableHello (false),
-    m_routingTable (m_deletePeriod),
-    m_queue (m_maxQueueLen, m_maxQueueTime),
+    m_probabilisticForwarding (false),
+    m_multipathDiscovery (false),
+    m_localFailover (false),
+    m_packetSalvaging (true),
+    m_salvageTimeout (Seconds (2)),
+    m_retransmitBufferLen (16),
+    m_retransmitBufferTimeout (MilliSeconds (500)),
+    m_maxDiscoveryPaths (3),
+    m_pheromoneDecay (DECAY_NONE),
+    m_evaporationRate (0.1),
+    m_pheromoneDeposit (0),
+    m_reinforcementInterval (MilliSeconds (100)),
+    m_routeCacheSize (0),
+    m_routeCacheRefreshInterval (MilliSeconds (500)),
+    m_fantIdCacheMode (ID_CACHE_EXACT),
+    m_dpdMode (DPD_EXACT),
+    m_dpdPackets (10000),
+    m_dpdFalsePositiveRate (0.001),
+    m_linkQualityWeight (0.1),
+    m_maxTxErrors (3),
+    m_linkQualityThreshold (0.2),
+    m_routingTable (m_deletePeriod, m_pheromoneDecay, m_evaporationRate),
+    m_routeCache (m_routeCacheSize, m_routeCacheRefreshInterval),
+    m_queue (m_maxQueueLen, m_maxQueueTime, m_maxQueueBytes, m_maxQueueLenPerDst),
+    m_retransmitBuffer (m_retransmitBufferLen, m_retransmitBufferTimeout),
     m_requestId (0),
     m_seqNo (0),
-    m_rreqIdCache (m_pathDiscoveryTime),
+    m_rreqIdCache (m_pathDiscoveryTime, m_fantIdCacheMode),
+    m_fantPathCache (m_pathDiscoveryTime),
     m_dpd (m_pathDiscoveryTime),
     m_nb (m_helloInterval),
     m_rreqCount (0),
     m_rerrCount (0),
+    m_localFailovers (0),
+    m_salvagedPackets (0),
+    m_salvagedPacketsSent (0),
+    m_reroutedPackets (0),
     m_htimer (Timer::CANCEL_ON_DESTROY),
     m_rreqRateLimitTimer (Timer::CANCEL_ON_DESTROY),
     m_rerrRateLimitTimer (Timer::CANCEL_ON_DESTROY),
     m_lastBcastTime (Seconds (0))
 {
-  m_nb.SetCallback (MakeCallback (&RoutingProtocol::SendRerrWhenBreaksLinkToNextHop, this));
+  m_nb.SetCallback (MakeCallback (&RoutingProtocol::HandleLinkFailure, this));
+  m_nb.SetTxStatusCallback (MakeCallback (&RoutingProtocol::ProcessTxStatus, this));
+  m_routingTable.SetPheromoneDeposit (m_pheromoneDeposit);
+  m_routingTable.SetReinforcementInterval (m_reinforcementInterval);
+  m_nb.SetLinkQualityWeight (m_linkQualityWeight);
+  m_nb.SetMaxTxErrors (m_maxTxErrors);
+  m_nb.SetLinkQualityThreshold (m_linkQualityThreshold);
+  m_nb.SetLinkQualityCallback (MakeCallback (&RoutingProtocol::UpdateLinkQuality, this));
+  m_routingTable.SetRouteChangeCallback (MakeCallback (&RouteCache::Invalidate, &m_routeCache));
 }
 
 TypeId
@@ -266,6 +307,16 @@ RoutingProtocol::GetTypeId (void)
                    MakeTimeAccessor (&RoutingProtocol::SetMaxQueueTime,
                                      &RoutingProtocol::GetMaxQueueTime),
                    MakeTimeChecker ())
+    .AddAttribute ("MaxQueueBytes", "Maximum number of bytes that we allow a routing protocol to buffer (0 for no limit).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&RoutingProtocol::SetMaxQueueBytes,
+                                         &RoutingProtocol::GetMaxQueueBytes),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("MaxQueueLenPerDestination", "Maximum number of packets buffered for one destination (0 for no limit).",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&RoutingProtocol::SetMaxQueueLenPerDestination,
+                                         &RoutingProtocol::GetMaxQueueLenPerDestination),
+                   MakeUintegerChecker<uint32_t> ())
     .AddAttribute ("AllowedHelloLoss", "Number of hello messages which may be loss for valid link.",
                    UintegerValue (2),
                    MakeUintegerAccessor (&RoutingProtocol::m_allowedHelloLoss),
@@ -290,6 +341,136 @@ RoutingProtocol::GetTypeId (void)
                    MakeBooleanAccessor (&RoutingProtocol::SetBroadcastEnable,
                                         &RoutingProtocol::GetBroadcastEnable),
                    MakeBooleanChecker ())
+    .AddAttribute ("ProbabilisticForwarding", "Indicates whether data packets are forwarded to a next hop chosen at random "
+                   "in proportion to its pheromone instead of always to the current next hop. The route cache is not used then.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RoutingProtocol::SetProbabilisticForwarding,
+                                        &RoutingProtocol::GetProbabilisticForwarding),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LocalFailover", "Indicates whether a route switches to its best remaining next hop when the link "
+                   "to its current next hop breaks, instead of being invalidated and reported in a RERR. Packets "
+                   "waiting for the route are sent on at once; with PacketSalvaging, forwarded packets still with "
+                   "the MAC for the broken link follow them over the new next hop.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RoutingProtocol::SetLocalFailover,
+                                        &RoutingProtocol::GetLocalFailover),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PacketSalvaging", "Indicates whether a forwarded packet without a valid route is buffered until the route "
+                   "is repaired or rediscovered, instead of being dropped, and whether forwarded packets lost on "
+                   "the way to their next hop are routed again.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&RoutingProtocol::SetPacketSalvaging,
+                                        &RoutingProtocol::GetPacketSalvaging),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SalvageTimeout", "Maximum time a forwarded packet is buffered for salvaging, capped by MaxQueueTime.",
+                   TimeValue (Seconds (2)),
+                   MakeTimeAccessor (&RoutingProtocol::m_salvageTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("RetransmitBufferLen", "Maximum number of forwarded packets per next hop remembered for routing them "
+                   "again if the Wi-Fi MAC drops them or the link breaks, 0 disables it.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&RoutingProtocol::SetRetransmitBufferLen,
+                                         &RoutingProtocol::GetRetransmitBufferLen),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RetransmitBufferTimeout", "Time a forwarded packet is remembered for routing it again. It should cover "
+                   "the time a frame waits in the MAC queue, and stay below ActiveRouteTimeout, after which an "
+                   "idle link is taken as broken.",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&RoutingProtocol::SetRetransmitBufferTimeout,
+                                     &RoutingProtocol::GetRetransmitBufferTimeout),
+                   MakeTimeChecker ())
+    .AddAttribute ("MultipathDiscovery", "Indicates whether copies of a FANT received from other previous hops add "
+                   "alternative reverse paths, each answered with a BANT by the destination. They are not rebroadcast.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RoutingProtocol::SetMultipathDiscovery,
+                                        &RoutingProtocol::GetMultipathDiscovery),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxDiscoveryPaths", "Maximum number of reverse paths learned from one FANT in multipath route discovery.",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&RoutingProtocol::m_maxDiscoveryPaths),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("PheromoneDecay", "Pheromone evaporation curve, evaluated when the pheromone is read. Applies to existing routes as well.",
+                   EnumValue (DECAY_NONE),
+                   MakeEnumAccessor (&RoutingProtocol::SetPheromoneDecay,
+                                     &RoutingProtocol::GetPheromoneDecay),
+                   MakeEnumChecker (DECAY_NONE, "None",
+                                    DECAY_EXPONENTIAL, "Exponential",
+                                    DECAY_LINEAR, "Linear"))
+    .AddAttribute ("EvaporationRate", "Fraction (exponential decay) or amount (linear decay) of pheromone evaporated per second. "
+                   "Fractions above 1 evaporate all pheromone at once. Applies to existing routes as well.",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&RoutingProtocol::SetEvaporationRate,
+                                       &RoutingProtocol::GetEvaporationRate),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("PheromoneDeposit", "Pheromone deposited by forwarded and originated data packets "
+                   "on the next hop that carries them towards the destination, at most once per ReinforcementInterval. "
+                   "0 disables reinforcement.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&RoutingProtocol::SetPheromoneDeposit,
+                                       &RoutingProtocol::GetPheromoneDeposit),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("ReinforcementInterval", "Minimum time between two pheromone deposits of data traffic "
+                   "on the same next hop of a destination; deposits of a burst within it are coalesced.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&RoutingProtocol::SetReinforcementInterval,
+                                     &RoutingProtocol::GetReinforcementInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("LinkQualityWeight", "Weight of a new Wi-Fi transmission attempt in the delivery ratio estimate "
+                   "of the link to a neighbor, which scales the pheromone of the neighbor as next hop. 0 disables the estimate.",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&RoutingProtocol::SetLinkQualityWeight,
+                                       &RoutingProtocol::GetLinkQualityWeight),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("MaxTxErrors", "Number of frames to a neighbor the Wi-Fi MAC may drop in a row "
+                   "before the link to the neighbor is considered broken.",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&RoutingProtocol::SetMaxTxErrors,
+                                         &RoutingProtocol::GetMaxTxErrors),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("LinkQualityThreshold", "Delivery ratio estimate below which a frame dropped by the Wi-Fi MAC "
+                   "breaks the link to the neighbor. 0 leaves only MaxTxErrors.",
+                   DoubleValue (0.2),
+                   MakeDoubleAccessor (&RoutingProtocol::SetLinkQualityThreshold,
+                                       &RoutingProtocol::GetLinkQualityThreshold),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("RouteCacheSize", "Number of slots of the cache of routes of locally originated flows, 0 disables the cache. "
+                   "The cache is bypassed while ProbabilisticForwarding is set.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&RoutingProtocol::SetRouteCacheSize,
+                                         &RoutingProtocol::GetRouteCacheSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RouteCacheRefreshInterval", "Interval between lifetime refreshes of a cached route. "
+                   "Should stay well below ActiveRouteTimeout.",
+                   TimeValue (MilliSeconds (500)),
+                   MakeTimeAccessor (&RoutingProtocol::SetRouteCacheRefreshInterval,
+                                     &RoutingProtocol::GetRouteCacheRefreshInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("FantIdCacheMode", "How FANT IDs are remembered for duplicate detection: one record per "
+                   "(origin, id) pair, or a sliding window of recent IDs per origin.",
+                   EnumValue (ID_CACHE_EXACT),
+                   MakeEnumAccessor (&RoutingProtocol::SetFantIdCacheMode,
+                                     &RoutingProtocol::GetFantIdCacheMode),
+                   MakeEnumChecker (ID_CACHE_EXACT, "Exact",
+                                    ID_CACHE_WINDOW, "Window"))
+    .AddAttribute ("DuplicateDetectionMode", "How broadcast data packets are remembered for duplicate detection: "
+                   "one record per packet, or a rotating pair of Bloom filters of constant size.",
+                   EnumValue (DPD_EXACT),
+                   MakeEnumAccessor (&RoutingProtocol::SetDuplicateDetectionMode,
+                                     &RoutingProtocol::GetDuplicateDetectionMode),
+                   MakeEnumChecker (DPD_EXACT, "Exact",
+                                    DPD_BLOOM, "Bloom"))
+    .AddAttribute ("DuplicateDetectionPackets", "Expected number of broadcast data packets per PathDiscoveryTime, "
+                   "which sizes the Bloom filters.",
+                   UintegerValue (10000),
+                   MakeUintegerAccessor (&RoutingProtocol::SetDuplicateDetectionPackets,
+                                         &RoutingProtocol::GetDuplicateDetectionPackets),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("DuplicateDetectionFalsePositiveRate", "False positive rate of duplicate detection, which checks both "
+                   "Bloom filters, with each filter at the expected number of broadcast data packets.",
+                   DoubleValue (0.001),
+                   MakeDoubleAccessor (&RoutingProtocol::SetDuplicateDetectionFalsePositiveRate,
+                                       &RoutingProtocol::GetDuplicateDetectionFalsePositiveRate),
+                   MakeDoubleChecker<double> (1e-6, 0.5))
     .AddAttribute ("UniformRv",
                    "Access to the underlying UniformRandomVariable",
                    StringValue ("ns3::UniformRandomVariable"),
@@ -306,11 +487,133 @@ RoutingProtocol::SetMaxQueueLen (uint32_t len)
   m_queue.SetMaxQueueLen (len);
 }
 void
+RoutingProtocol::SetMaxQueueBytes (uint32_t bytes)
+{
+  m_maxQueueBytes = bytes;
+  m_queue.SetMaxQueueBytes (bytes);
+}
+void
+RoutingProtocol::SetMaxQueueLenPerDestination (uint32_t len)
+{
+  m_maxQueueLenPerDst = len;
+  m_queue.SetMaxQueueLenPerDestination (len);
+}
+void
 RoutingProtocol::SetMaxQueueTime (Time t)
 {
   m_maxQueueTime = t;
   m_queue.SetQueueTimeout (t);
 }
+void
+RoutingProtocol::SetPheromoneDecay (PheromoneDecay decay)
+{
+  m_pheromoneDecay = decay;
+  m_routingTable.SetPheromoneDecay (decay);
+}
+void
+RoutingProtocol::SetEvaporationRate (double rate)
+{
+  m_evaporationRate = rate;
+  m_routingTable.SetEvaporationRate (rate);
+}
+void
+RoutingProtocol::SetPheromoneDeposit (double deposit)
+{
+  m_pheromoneDeposit = deposit;
+  m_routingTable.SetPheromoneDeposit (deposit);
+}
+void
+RoutingProtocol::SetReinforcementInterval (Time t)
+{
+  m_reinforcementInterval = t;
+  m_routingTable.SetReinforcementInterval (t);
+}
+void
+RoutingProtocol::SetLinkQualityWeight (double weight)
+{
+  m_linkQualityWeight = weight;
+  m_nb.SetLinkQualityWeight (weight);
+}
+void
+RoutingProtocol::SetMaxTxErrors (uint32_t errors)
+{
+  m_maxTxErrors = errors;
+  m_nb.SetMaxTxErrors (errors);
+}
+void
+RoutingProtocol::SetLinkQualityThreshold (double threshold)
+{
+  m_linkQualityThreshold = threshold;
+  m_nb.SetLinkQualityThreshold (threshold);
+}
+void
+RoutingProtocol::SetRetransmitBufferLen (uint32_t len)
+{
+  m_retransmitBufferLen = len;
+  m_retransmitBuffer.SetMaxLen (len);
+}
+void
+RoutingProtocol::SetRetransmitBufferTimeout (Time t)
+{
+  m_retransmitBufferTimeout = t;
+  m_retransmitBuffer.SetTimeout (t);
+}
+void
+RoutingProtocol::SetRouteCacheSize (uint32_t size)
+{
+  m_routeCacheSize = size;
+  m_routeCache.SetSize (size);
+}
+void
+RoutingProtocol::SetRouteCacheRefreshInterval (Time t)
+{
+  m_routeCacheRefreshInterval = t;
+  m_routeCache.SetRefreshInterval (t);
+}
+void
+RoutingProtocol::SetFantIdCacheMode (IdCacheMode mode)
+{
+  m_fantIdCacheMode = mode;
+  m_rreqIdCache.SetMode (mode);
+}
+void
+RoutingProtocol::SetDuplicateDetectionMode (DuplicateDetectionMode mode)
+{
+  m_dpdMode = mode;
+  m_dpd.SetMode (mode);
+}
+void
+RoutingProtocol::SetDuplicateDetectionPackets (uint32_t packets)
+{
+  m_dpdPackets = packets;
+  m_dpd.SetBloomFilter (m_dpdPackets, m_dpdFalsePositiveRate);
+}
+void
+RoutingProtocol::SetDuplicateDetectionFalsePositiveRate (double rate)
+{
+  m_dpdFalsePositiveRate = rate;
+  m_dpd.SetBloomFilter (m_dpdPackets, m_dpdFalsePositiveRate);
+}
+uint32_t
+RoutingProtocol::GetDuplicateDetectionMemoryUsage ()
+{
+  return m_dpd.GetMemoryUsage ();
+}
+uint64_t
+RoutingProtocol::GetDuplicatePackets () const
+{
+  return m_dpd.GetDuplicates ();
+}
+double
+RoutingProtocol::GetDuplicateDetectionEstimatedFalsePositiveRate () const
+{
+  return m_dpd.GetFalsePositiveRate ();
+}
+uint64_t
+RoutingProtocol::GetDuplicateDetectionEarlyRotations () const
+{
+  return m_dpd.GetEarlyRotations ();
+}
 
 RoutingProtocol::~RoutingProtocol ()
 {
@@ -332,6 +635,8 @@ RoutingProtocol::DoDispose ()
       iter->first->Close ();
     }
   m_socketSubnetBroadcastAddresses.clear ();
+  m_routeCache.Clear ();
+  m_retransmitBuffer.Clear ();
   Ipv4RoutingProtocol::DoDispose ();
 }
 
@@ -393,10 +698,23 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
   sockerr = Socket::ERROR_NOTERROR;
   Ptr<Ipv4Route> route;
   Ipv4Address dst = header.GetDestination ();
-  RoutingTableEntry rt;
-  if (m_routingTable.LookupValidRoute (dst, rt))
+  uint32_t flowHash = RouteCache::GetFlowHash (header);
+  // A cached route would pin each flow to one next hop instead of spreading its packets
+  bool cached = !m_probabilisticForwarding;
+  if (cached)
+    {
+      // The lifetime bookkeeping of a cached route is only done once per refresh
+      // interval, when the lookup misses and the route is refreshed below
+      route = m_routeCache.Lookup (dst, oif, flowHash);
+      if (route != 0)
+        {
+          return route;
+        }
+    }
+  RoutingTableEntry const * rt = m_routingTable.FindValidRoute (dst);
+  if (rt != 0)
     {
-      route = rt.GetRoute ();
+      route = SelectRoute (*rt);
       NS_ASSERT (route != 0);
       NS_LOG_DEBUG ("Exist route to " << route->GetDestination () << " from interface " << route->GetSource ());
       if (oif != 0 && route->GetOutputDevice () != oif)
@@ -405,8 +723,13 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header,
           sockerr = Socket::ERROR_NOROUTETOHOST;
           return Ptr<Ipv4Route> ();
         }
-      UpdateRouteLifeTime (dst, m_activeRouteTimeout);
+      UpdateRouteLifeTime (dst, m_activeRouteTimeout, route->GetGateway ());
+      Time expire = Simulator::Now () + rt->GetLifeTime ();
       UpdateRouteLifeTime (route->GetGateway (), m_activeRouteTimeout);
+      if (cached)
+        {
+          m_routeCache.Insert (dst, oif, flowHash, route, expire);
+        }
       return route;
     }
 
@@ -445,6 +768,32 @@ RoutingProtocol::DeferredRouteOutput (Ptr<const Packet> p, const Ipv4Header & he
     }
 }
 
+bool
+RoutingProtocol::SalvagePacket (Ptr<const Packet> p, const Ipv4Header & header,
+                                UnicastForwardCallback ucb, ErrorCallback ecb)
+{
+  NS_LOG_FUNCTION (this << p->GetUid () << header.GetDestination ());
+  // The queue reports a packet larger than itself through ecb; leave the drop to the caller instead
+  if (m_queue.GetMaxQueueBytes () != 0 && p->GetSize () > m_queue.GetMaxQueueBytes ())
+    {
+      return false;
+    }
+  QueueEntry newEntry (p, header, ucb, ecb);
+  if (!m_queue.Enqueue (newEntry, m_salvageTimeout))
+    {
+      return false;
+    }
+  NS_LOG_LOGIC ("Salvage packet " << p->GetUid () << " to " << header.GetDestination ());
+  ++m_salvagedPackets;
+  RoutingTableEntry rt;
+  if (!m_routingTable.LookupRoute (header.GetDestination (), rt) || rt.GetFlag () != IN_SEARCH)
+    {
+      NS_LOG_LOGIC ("Send local RREQ for salvaged packet to " << header.GetDestination ());
+      SendRequest (header.GetDestination ());
+    }
+  return true;
+}
+
 bool
 RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
                              Ptr<const NetDevice> idev, UnicastForwardCallback ucb,
@@ -556,11 +905,12 @@ RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
   if (m_ipv4->IsDestinationAddress (dst, iif))
     {
       UpdateRouteLifeTime (origin, m_activeRouteTimeout);
-      RoutingTableEntry toOrigin;
-      if (m_routingTable.LookupValidRoute (origin, toOrigin))
+      RoutingTableEntry const * toOrigin = m_routingTable.FindValidRoute (origin);
+      if (toOrigin != 0)
         {
-          UpdateRouteLifeTime (toOrigin.GetNextHop (), m_activeRouteTimeout);
-          m_nb.Update (toOrigin.GetNextHop (), m_activeRouteTimeout);
+          Ipv4Address prev = toOrigin->GetNextHop ();
+          UpdateRouteLifeTime (prev, m_activeRouteTimeout);
+          m_nb.Update (prev, m_activeRouteTimeout);
         }
       if (lcb.IsNull () == false)
         {
@@ -589,18 +939,18 @@ RoutingProtocol::RouteInput (Ptr<const Packet> p, const Ipv4Header &header,
 
 bool
 RoutingProtocol::Forwarding (Ptr<const Packet> p, const Ipv4Header & header,
-                             UnicastForwardCallback ucb, ErrorCallback ecb)
+                             UnicastForwardCallback ucb, ErrorCallback ecb, bool rerouted)
 {
   NS_LOG_FUNCTION (this);
   Ipv4Address dst = header.GetDestination ();
   Ipv4Address origin = header.GetSource ();
-  m_routingTable.Purge ();
-  RoutingTableEntry toDst;
-  if (m_routingTable.LookupRoute (dst, toDst))
+  // Resolved through NodeIdMap::Lookup: a destination without an ID is a miss and is not interned
+  RoutingTableEntry const * toDst = m_routingTable.FindRoute (dst);
+  if (toDst != 0)
     {
-      if (toDst.GetFlag () == VALID)
+      if (toDst->GetFlag () == VALID)
         {
-          Ptr<Ipv4Route> route = toDst.GetRoute ();
+          Ptr<Ipv4Route> route = SelectRoute (*toDst);
           NS_LOG_LOGIC (route->GetSource () << " forwarding to " << dst << " from " << origin << " packet " << p->GetUid ());
 
           /*
@@ -608,41 +958,73 @@ RoutingProtocol::Forwarding (Ptr<const Packet> p, const Ipv4Header & header,
            *  Lifetime field of the source, destination and the next hop on the
            *  path to the destination is updated to be no less than the current
            *  time plus ActiveRouteTimeout.
-           */
-          UpdateRouteLifeTime (origin, m_activeRouteTimeout);
-          UpdateRouteLifeTime (dst, m_activeRouteTimeout);
-          UpdateRouteLifeTime (route->GetGateway (), m_activeRouteTimeout);
-          /*
            *  Since the route between each originator and destination pair is expected to be symmetric, the
            *  Active Route Lifetime for the previous hop, along the reverse path back to the IP source, is also updated
-           *  to be no less than the current time plus ActiveRouteTimeout
+           *  to be no less than the current time plus ActiveRouteTimeout.
+           *  All four entries are refreshed in one pass, each resolved once, and the
+           *  record of the next hop towards the destination is reinforced with pheromone.
            */
-          RoutingTableEntry toOrigin;
-          m_routingTable.LookupRoute (origin, toOrigin);
-          UpdateRouteLifeTime (toOrigin.GetNextHop (), m_activeRouteTimeout);
-
-          m_nb.Update (route->GetGateway (), m_activeRouteTimeout);
-          m_nb.Update (toOrigin.GetNextHop (), m_activeRouteTimeout);
+          Ipv4Address prev = m_routingTable.RefreshForwardingPath (toDst, route->GetGateway (),
+                                                                   origin, m_activeRouteTimeout);
+          if (prev != Ipv4Address ())
+            {
+              m_nb.Update (route->GetGateway (), prev, m_activeRouteTimeout);
+            }
+          else
+            {
+              m_nb.Update (route->GetGateway (), m_activeRouteTimeout);
+            }
 
+          if (m_packetSalvaging && !rerouted && m_retransmitBuffer.GetMaxLen () != 0)
+            {
+              QueueEntry entry (p, header, ucb, ecb);
+              m_retransmitBuffer.Add (route->GetGateway (), entry);
+            }
           ucb (route, p, header);
           return true;
         }
       else
         {
-          if (toDst.GetValidSeqNo ())
+          if (m_packetSalvaging && SalvagePacket (p, header, ucb, ecb))
             {
-              SendRerrWhenNoRouteToForward (dst, toDst.GetSeqNo (), origin);
+              return true;
+            }
+          if (toDst->GetValidSeqNo ())
+            {
+              SendRerrWhenNoRouteToForward (dst, toDst->GetSeqNo (), origin);
               NS_LOG_DEBUG ("Drop packet " << p->GetUid () << " because no route to forward it.");
               return false;
             }
         }
     }
+  else if (m_packetSalvaging && SalvagePacket (p, header, ucb, ecb))
+    {
+      // No entry at all, e.g. after the route expired and was deleted
+      return true;
+    }
   NS_LOG_LOGIC ("route not found to " << dst << ". Send RERR message.");
   NS_LOG_DEBUG ("Drop packet " << p->GetUid () << " because no route to forward it.");
   SendRerrWhenNoRouteToForward (dst, 0, origin);
   return false;
 }
 
+void
+RoutingProtocol::Reroute (QueueEntry const & entry)
+{
+  Ptr<const Packet> p = entry.GetPacket ();
+  Ipv4Header const & header = entry.GetIpv4Header ();
+  NS_LOG_FUNCTION (this << p->GetUid () << header.GetDestination ());
+  // The packet never reached the next hop, so it keeps its header and TTL
+  if (Forwarding (p, header, entry.GetUnicastForwardCallback (), entry.GetErrorCallback (), true))
+    {
+      ++m_reroutedPackets;
+    }
+  else
+    {
+      entry.GetErrorCallback () (p, header, Socket::ERROR_NOROUTETOHOST);
+    }
+}
+
 void
 RoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
 {
@@ -658,7 +1040,7 @@ RoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
   // Remember lo route
   RoutingTableEntry rt (/*device=*/ m_lo, /*dst=*/ Ipv4Address::GetLoopback (), /*know seqno=*/ true, /*seqno=*/ 0,
                                     /*iface=*/ Ipv4InterfaceAddress (Ipv4Address::GetLoopback (), Ipv4Mask ("255.0.0.0")),
-                                    /*pheromone=*/ 1, /*next hop=*/ Ipv4Address::GetLoopback (),
+                                    /*hops=*/ 1, /*next hop=*/ Ipv4Address::GetLoopback (),
                                     /*lifetime=*/ Simulator::GetMaximumSimulationTime ());
   m_routingTable.AddRoute (rt);
 
@@ -705,7 +1087,7 @@ RoutingProtocol::NotifyInterfaceUp (uint32_t i)
   // Add local broadcast record to the routing table
   Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (iface.GetLocal ()));
   RoutingTableEntry rt (/*device=*/ dev, /*dst=*/ iface.GetBroadcast (), /*know seqno=*/ true, /*seqno=*/ 0, /*iface=*/ iface,
-                                    /*pheromone=*/ 1, /*next hop=*/ iface.GetBroadcast (), /*lifetime=*/ Simulator::GetMaximumSimulationTime ());
+                                    /*hops=*/ 1, /*next hop=*/ iface.GetBroadcast (), /*lifetime=*/ Simulator::GetMaximumSimulationTime ());
   m_routingTable.AddRoute (rt);
 
   if (l3->GetInterface (i)->GetArpCache ())
@@ -726,6 +1108,13 @@ RoutingProtocol::NotifyInterfaceUp (uint32_t i)
     }
 
   mac->TraceConnectWithoutContext ("TxErrHeader", m_nb.GetTxErrorCallback ());
+  mac->TraceConnectWithoutContext ("TxOkHeader", m_nb.GetTxOkCallback ());
+  // The MAC reports a frame once; its failed attempts are reported by the station manager
+  Ptr<WifiRemoteStationManager> manager = wifi->GetRemoteStationManager ();
+  if (manager != 0)
+    {
+      manager->TraceConnectWithoutContext ("MacTxDataFailed", m_nb.GetTxDataFailedCallback ());
+    }
 }
 
 void
@@ -744,6 +1133,14 @@ RoutingProtocol::NotifyInterfaceDown (uint32_t i)
         {
           mac->TraceDisconnectWithoutContext ("TxErrHeader",
                                               m_nb.GetTxErrorCallback ());
+          mac->TraceDisconnectWithoutContext ("TxOkHeader",
+                                              m_nb.GetTxOkCallback ());
+          Ptr<WifiRemoteStationManager> manager = wifi->GetRemoteStationManager ();
+          if (manager != 0)
+            {
+              manager->TraceDisconnectWithoutContext ("MacTxDataFailed",
+                                                      m_nb.GetTxDataFailedCallback ());
+            }
           m_nb.DelArpCache (l3->GetInterface (i)->GetArpCache ());
         }
     }
@@ -815,7 +1212,7 @@ RoutingProtocol::NotifyAddAddress (uint32_t i, Ipv4InterfaceAddress address)
           Ptr<NetDevice> dev = m_ipv4->GetNetDevice (
               m_ipv4->GetInterfaceForAddress (iface.GetLocal ()));
           RoutingTableEntry rt (/*device=*/ dev, /*dst=*/ iface.GetBroadcast (), /*know seqno=*/ true,
-                                            /*seqno=*/ 0, /*iface=*/ iface, /*pheromone=*/ 1,
+                                            /*seqno=*/ 0, /*iface=*/ iface, /*hops=*/ 1,
                                             /*next hop=*/ iface.GetBroadcast (), /*lifetime=*/ Simulator::GetMaximumSimulationTime ());
           m_routingTable.AddRoute (rt);
         }
@@ -874,7 +1271,7 @@ RoutingProtocol::NotifyRemoveAddress (uint32_t i, Ipv4InterfaceAddress address)
           // Add local broadcast record to the routing table
           Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (iface.GetLocal ()));
           RoutingTableEntry rt (/*device=*/ dev, /*dst=*/ iface.GetBroadcast (), /*know seqno=*/ true, /*seqno=*/ 0, /*iface=*/ iface,
-                                            /*pheromone=*/ 1, /*next hop=*/ iface.GetBroadcast (), /*lifetime=*/ Simulator::GetMaximumSimulationTime ());
+                                            /*hops=*/ 1, /*next hop=*/ iface.GetBroadcast (), /*lifetime=*/ Simulator::GetMaximumSimulationTime ());
           m_routingTable.AddRoute (rt);
         }
       if (m_socketAddresses.empty ())
@@ -976,17 +1373,17 @@ RoutingProtocol::SendRequest (Ipv4Address dst)
   fantHeader.SetDst (dst);
 
   RoutingTableEntry rt;
-  // Using the pheromone field in Routing Table to manage the expanding ring search
+  // Using the hop count field in Routing Table to manage the expanding ring search
   uint16_t ttl = m_ttlStart;
   if (m_routingTable.LookupRoute (dst, rt))
     {
       if (rt.GetFlag () != IN_SEARCH)
         {
-          ttl = std::min<uint16_t> (rt.GetPheromone () + m_ttlIncrement, m_netDiameter);
+          ttl = std::min<uint16_t> (rt.GetHop () + m_ttlIncrement, m_netDiameter);
         }
       else
         {
-          ttl = rt.GetPheromone () + m_ttlIncrement;
+          ttl = rt.GetHop () + m_ttlIncrement;
           if (ttl > m_ttlThreshold)
             {
               ttl = m_netDiameter;
@@ -1004,7 +1401,7 @@ RoutingProtocol::SendRequest (Ipv4Address dst)
         {
           fantHeader.SetUnknownSeqno (true);
         }
-      rt.SetPheromone (ttl);
+      rt.SetHop (ttl);
       rt.SetFlag (IN_SEARCH);
       rt.SetLifeTime (m_pathDiscoveryTime);
       m_routingTable.Update (rt);
@@ -1014,7 +1411,7 @@ RoutingProtocol::SendRequest (Ipv4Address dst)
       fantHeader.SetUnknownSeqno (true);
       Ptr<NetDevice> dev = 0;
       RoutingTableEntry newEntry (/*device=*/ dev, /*dst=*/ dst, /*validSeqNo=*/ false, /*seqno=*/ 0,
-                                              /*iface=*/ Ipv4InterfaceAddress (),/*pheromone=*/ ttl,
+                                              /*iface=*/ Ipv4InterfaceAddress (),/*hops=*/ ttl,
                                               /*nextHop=*/ Ipv4Address (), /*lifeTime=*/ m_pathDiscoveryTime);
       // Check if TtlStart == NetDiameter
       if (ttl == m_netDiameter)
@@ -1094,9 +1491,9 @@ RoutingProtocol::ScheduleRreqRetry (Ipv4Address dst)
   RoutingTableEntry rt;
   m_routingTable.LookupRoute (dst, rt);
   Time retry;
-  if (rt.GetPheromone () < m_netDiameter)
+  if (rt.GetHop () < m_netDiameter)
     {
-      retry = 2 * m_nodeTraversalTime * (rt.GetPheromone () + m_timeoutBuffer);
+      retry = 2 * m_nodeTraversalTime * (rt.GetHop () + m_timeoutBuffer);
     }
   else
     {
@@ -1167,24 +1564,27 @@ RoutingProtocol::RecvAodv (Ptr<Socket> socket)
 }
 
 bool
-RoutingProtocol::UpdateRouteLifeTime (Ipv4Address addr, Time lifetime)
+RoutingProtocol::UpdateRouteLifeTime (Ipv4Address addr, Time lifetime, Ipv4Address nextHop)
 {
   NS_LOG_FUNCTION (this << addr << lifetime);
-  RoutingTableEntry rt;
-  if (m_routingTable.LookupRoute (addr, rt))
+  if (m_routingTable.RefreshRoute (addr, lifetime, nextHop))
     {
-      if (rt.GetFlag () == VALID)
-        {
-          NS_LOG_DEBUG ("Updating VALID route");
-          rt.SetRreqCnt (0);
-          rt.SetLifeTime (std::max (lifetime, rt.GetLifeTime ()));
-          m_routingTable.Update (rt);
-          return true;
-        }
+      NS_LOG_DEBUG ("Updating VALID route");
+      return true;
     }
   return false;
 }
 
+Ptr<Ipv4Route>
+RoutingProtocol::SelectRoute (RoutingTableEntry const & rt)
+{
+  if (!m_probabilisticForwarding || rt.GetNextHopCount () < 2)
+    {
+      return rt.GetRoute ();
+    }
+  return rt.SelectRoute (m_uniformRandomVariable->GetValue ());
+}
+
 void
 RoutingProtocol::UpdateRouteToNeighbor (Ipv4Address sender, Ipv4Address receiver)
 {
@@ -1195,13 +1595,13 @@ RoutingProtocol::UpdateRouteToNeighbor (Ipv4Address sender, Ipv4Address receiver
       Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver));
       RoutingTableEntry newEntry (/*device=*/ dev, /*dst=*/ sender, /*know seqno=*/ false, /*seqno=*/ 0,
                                               /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),
-                                              /*pheromone=*/ 1, /*next hop=*/ sender, /*lifetime=*/ m_activeRouteTimeout);
+                                              /*hops=*/ 1, /*next hop=*/ sender, /*lifetime=*/ m_activeRouteTimeout);
       m_routingTable.AddRoute (newEntry);
     }
   else
     {
       Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver));
-      if (toNeighbor.GetValidSeqNo () && (toNeighbor.GetPheromone () == 1) && (toNeighbor.GetOutputDevice () == dev))
+      if (toNeighbor.GetValidSeqNo () && (toNeighbor.GetHop () == 1) && (toNeighbor.GetOutputDevice () == dev))
         {
           toNeighbor.SetLifeTime (std::max (m_activeRouteTimeout, toNeighbor.GetLifeTime ()));
         }
@@ -1209,7 +1609,7 @@ RoutingProtocol::UpdateRouteToNeighbor (Ipv4Address sender, Ipv4Address receiver
         {
           RoutingTableEntry newEntry (/*device=*/ dev, /*dst=*/ sender, /*know seqno=*/ false, /*seqno=*/ 0,
                                                   /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),
-                                                  /*pheromone=*/ 1, /*next hop=*/ sender, /*lifetime=*/ std::max (m_activeRouteTimeout, toNeighbor.GetLifeTime ()));
+                                                  /*hops=*/ 1, /*next hop=*/ sender, /*lifetime=*/ std::max (m_activeRouteTimeout, toNeighbor.GetLifeTime ()));
           m_routingTable.Update (newEntry);
         }
     }
@@ -1243,13 +1643,22 @@ RoutingProtocol::RecvRequest (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address s
    */
   if (m_rreqIdCache.IsDuplicate (origin, id))
     {
+      if (m_multipathDiscovery)
+        {
+          RecvAlternativeRequest (fantHeader, receiver, src);
+          return;
+        }
       NS_LOG_DEBUG ("Ignoring FANT due to duplicate");
       return;
     }
 
   // Increment FANT hop count
-  uint8_t pheromone = fantHeader.GetPheromone () + 1;
-  fantHeader.SetPheromone (pheromone);
+  uint8_t hops = fantHeader.GetPheromone () + 1;
+  fantHeader.SetPheromone (hops);
+  if (m_multipathDiscovery)
+    {
+      m_fantPathCache.AddFirst (origin, id, src, hops);
+    }
 
   /*
    *  When the reverse route is created or updated, the following actions on the route are also carried out:
@@ -1266,8 +1675,8 @@ RoutingProtocol::RecvRequest (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address s
     {
       Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver));
       RoutingTableEntry newEntry (/*device=*/ dev, /*dst=*/ origin, /*validSeno=*/ true, /*seqNo=*/ fantHeader.GetOriginSeqno (),
-                                              /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0), /*pheromone=*/ pheromone,
-                                              /*nextHop*/ src, /*timeLife=*/ Time ((2 * m_netTraversalTime - 2 * pheromone * m_nodeTraversalTime)));
+                                              /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0), /*hops=*/ hops,
+                                              /*nextHop*/ src, /*timeLife=*/ Time ((2 * m_netTraversalTime - 2 * hops * m_nodeTraversalTime)));
       m_routingTable.AddRoute (newEntry);
     }
   else
@@ -1287,9 +1696,14 @@ RoutingProtocol::RecvRequest (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address s
       toOrigin.SetNextHop (src);
       toOrigin.SetOutputDevice (m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver)));
       toOrigin.SetInterface (m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0));
-      toOrigin.SetPheromone (pheromone);
-      toOrigin.SetLifeTime (std::max (Time (2 * m_netTraversalTime - 2 * pheromone * m_nodeTraversalTime),
+      toOrigin.SetHop (hops);
+      toOrigin.SetLifeTime (std::max (Time (2 * m_netTraversalTime - 2 * hops * m_nodeTraversalTime),
                                       toOrigin.GetLifeTime ()));
+      // Previous hops learned from earlier FANTs stay in the pheromone table as alternatives
+      toOrigin.AddNextHop (src, m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver)),
+                           m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),
+                           RoutingTableEntry::GetInitialPheromone (hops),
+                           toOrigin.GetLifeTime ());
       m_routingTable.Update (toOrigin);
       //m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
     }
@@ -1313,13 +1727,17 @@ RoutingProtocol::RecvRequest (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address s
       toNeighbor.SetFlag (VALID);
       toNeighbor.SetOutputDevice (m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver)));
       toNeighbor.SetInterface (m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0));
-      toNeighbor.SetPheromone (1);
+      toNeighbor.SetHop (1);
       toNeighbor.SetNextHop (src);
+      toNeighbor.AddNextHop (src, m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver)),
+                             m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),
+                             RoutingTableEntry::GetInitialPheromone (1),
+                             m_activeRouteTimeout);
       m_routingTable.Update (toNeighbor);
     }
   m_nb.Update (src, Time (m_allowedHelloLoss * m_helloInterval));
 
-  NS_LOG_LOGIC (receiver << " receive FANT with pheromone count " << static_cast<uint32_t> (fantHeader.GetPheromone ())
+  NS_LOG_LOGIC (receiver << " receive FANT with hop count " << static_cast<uint32_t> (fantHeader.GetPheromone ())
                          << " ID " << fantHeader.GetId ()
                          << " to destination " << fantHeader.GetDst ());
 
@@ -1404,10 +1822,51 @@ RoutingProtocol::RecvRequest (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address s
     }
 }
 
+void
+RoutingProtocol::RecvAlternativeRequest (FANTHeader const & fantHeader, Ipv4Address receiver, Ipv4Address src)
+{
+  NS_LOG_FUNCTION (this << src);
+  Ipv4Address origin = fantHeader.GetOrigin ();
+  uint16_t hops = fantHeader.GetPheromone () + 1;
+  if (!m_fantPathCache.AddAlternative (origin, fantHeader.GetId (), src, hops, m_maxDiscoveryPaths))
+    {
+      NS_LOG_DEBUG ("Ignoring FANT due to duplicate");
+      return;
+    }
+  RoutingTableEntry toOrigin;
+  if (!m_routingTable.LookupRoute (origin, toOrigin) || toOrigin.GetFlag () != VALID)
+    {
+      return;
+    }
+  NS_LOG_LOGIC (receiver << " learned alternative path to " << origin << " through " << src
+                         << " with hop count " << hops);
+  int32_t interface = m_ipv4->GetInterfaceForAddress (receiver);
+  Ipv4InterfaceAddress iface = m_ipv4->GetAddress (interface, 0);
+  toOrigin.AddNextHop (src, m_ipv4->GetNetDevice (interface), iface,
+                       RoutingTableEntry::GetInitialPheromone (hops),
+                       toOrigin.GetLifeTime ());
+  m_routingTable.Update (toOrigin);
+  UpdateRouteToNeighbor (src, receiver);
+  m_nb.Update (src, Time (m_allowedHelloLoss * m_helloInterval));
+
+  if (IsMyOwnAddress (fantHeader.GetDst ()))
+    {
+      NS_LOG_DEBUG ("Send reply along alternative path through " << src);
+      SendReply (fantHeader, origin, src, iface, hops);
+    }
+}
+
 void
 RoutingProtocol::SendReply (FANTHeader const & fantHeader, RoutingTableEntry const & toOrigin)
 {
-  NS_LOG_FUNCTION (this << toOrigin.GetDestination ());
+  SendReply (fantHeader, toOrigin.GetDestination (), toOrigin.GetNextHop (), toOrigin.GetInterface (), toOrigin.GetHop ());
+}
+
+void
+RoutingProtocol::SendReply (FANTHeader const & fantHeader, Ipv4Address origin, Ipv4Address nextHop,
+                            Ipv4InterfaceAddress iface, uint16_t hops)
+{
+  NS_LOG_FUNCTION (this << origin << nextHop);
   /*
    * Destination node MUST increment its own sequence number by one if the sequence number in the FANT packet is equal to that
    * incremented value. Otherwise, the destination does not change its sequence number before generating the  RREP message.
@@ -1417,29 +1876,33 @@ RoutingProtocol::SendReply (FANTHeader const & fantHeader, RoutingTableEntry con
       m_seqNo++;
     }
   BANTHeader bantHeader ( /*prefixSize=*/ 0, /*pheromone=*/ 0, /*dst=*/ fantHeader.GetDst (),
-                                          /*dstSeqNo=*/ m_seqNo, /*origin=*/ toOrigin.GetDestination (), /*lifeTime=*/ m_myRouteTimeout);
+                                          /*dstSeqNo=*/ m_seqNo, /*origin=*/ origin, /*lifeTime=*/ m_myRouteTimeout);
+  if (m_multipathDiscovery)
+    {
+      bantHeader.SetFantId (fantHeader.GetId ());
+    }
   Ptr<Packet> packet = Create<Packet> ();
   SocketIpTtlTag tag;
-  tag.SetTtl (toOrigin.GetPheromone ());
+  tag.SetTtl (hops);
   packet->AddPacketTag (tag);
   packet->AddHeader (bantHeader);
   TypeHeader tHeader (ARATYPE_BANT);
   packet->AddHeader (tHeader);
-  Ptr<Socket> socket = FindSocketWithInterfaceAddress (toOrigin.GetInterface ());
+  Ptr<Socket> socket = FindSocketWithInterfaceAddress (iface);
   NS_ASSERT (socket);
-  socket->SendTo (packet, 0, InetSocketAddress (toOrigin.GetNextHop (), AODV_PORT));
+  socket->SendTo (packet, 0, InetSocketAddress (nextHop, AODV_PORT));
 }
 
 void
 RoutingProtocol::SendReplyByIntermediateNode (RoutingTableEntry & toDst, RoutingTableEntry & toOrigin, bool gratRep)
 {
   NS_LOG_FUNCTION (this);
-  BANTHeader bantHeader (/*prefix size=*/ 0, /*pheromone=*/ toDst.GetPheromone (), /*dst=*/ toDst.GetDestination (), /*dst seqno=*/ toDst.GetSeqNo (),
+  BANTHeader bantHeader (/*prefix size=*/ 0, /*pheromone=*/ toDst.GetHop (), /*dst=*/ toDst.GetDestination (), /*dst seqno=*/ toDst.GetSeqNo (),
                                           /*origin=*/ toOrigin.GetDestination (), /*lifetime=*/ toDst.GetLifeTime ());
   /* If the node we received a FANT for is a neighbor we are
    * probably facing a unidirectional link... Better request a RREP-ack
    */
-  if (toDst.GetPheromone () == 1)
+  if (toDst.GetHop () == 1)
     {
       bantHeader.SetAckRequired (true);
       RoutingTableEntry toNextHop;
@@ -1455,7 +1918,7 @@ RoutingProtocol::SendReplyByIntermediateNode (RoutingTableEntry & toDst, Routing
 
   Ptr<Packet> packet = Create<Packet> ();
   SocketIpTtlTag tag;
-  tag.SetTtl (toOrigin.GetPheromone ());
+  tag.SetTtl (toOrigin.GetHop ());
   packet->AddPacketTag (tag);
   packet->AddHeader (bantHeader);
   TypeHeader tHeader (ARATYPE_BANT);
@@ -1467,12 +1930,12 @@ RoutingProtocol::SendReplyByIntermediateNode (RoutingTableEntry & toDst, Routing
   // Generating gratuitous RREPs
   if (gratRep)
     {
-      BANTHeader gratRepHeader (/*prefix size=*/ 0, /*pheromone=*/ toOrigin.GetPheromone (), /*dst=*/ toOrigin.GetDestination (),
+      BANTHeader gratRepHeader (/*prefix size=*/ 0, /*pheromone=*/ toOrigin.GetHop (), /*dst=*/ toOrigin.GetDestination (),
                                                  /*dst seqno=*/ toOrigin.GetSeqNo (), /*origin=*/ toDst.GetDestination (),
                                                  /*lifetime=*/ toOrigin.GetLifeTime ());
       Ptr<Packet> packetToDst = Create<Packet> ();
       SocketIpTtlTag gratTag;
-      gratTag.SetTtl (toDst.GetPheromone ());
+      gratTag.SetTtl (toDst.GetHop ());
       packetToDst->AddPacketTag (gratTag);
       packetToDst->AddHeader (gratRepHeader);
       TypeHeader type (ARATYPE_BANT);
@@ -1512,8 +1975,8 @@ RoutingProtocol::RecvReply (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sen
   Ipv4Address dst = bantHeader.GetDst ();
   NS_LOG_LOGIC ("BANT destination " << dst << " BANT origin " << bantHeader.GetOrigin ());
 
-  uint8_t pheromone = bantHeader.GetHopCount () + 1;
-  bantHeader.SetHopCount (pheromone);
+  uint8_t hops = bantHeader.GetHopCount () + 1;
+  bantHeader.SetHopCount (hops);
 
   // If BANT is Hello message
   if (dst == bantHeader.GetOrigin ())
@@ -1534,7 +1997,7 @@ RoutingProtocol::RecvReply (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sen
    */
   Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver));
   RoutingTableEntry newEntry (/*device=*/ dev, /*dst=*/ dst, /*validSeqNo=*/ true, /*seqno=*/ bantHeader.GetDstSeqno (),
-                                          /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),/*pheromone=*/ pheromone,
+                                          /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),/*hops=*/ hops,
                                           /*nextHop=*/ sender, /*lifeTime=*/ bantHeader.GetLifeTime ());
   RoutingTableEntry toDst;
   if (m_routingTable.LookupRoute (dst, toDst))
@@ -1559,10 +2022,26 @@ RoutingProtocol::RecvReply (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sen
             {
               m_routingTable.Update (newEntry);
             }
-          // (iv)  the sequence numbers are the same, and the New Hop Count is smaller than the hop count in route table entry.
-          else if ((bantHeader.GetDstSeqno () == toDst.GetSeqNo ()) && (pheromone < toDst.GetPheromone ()))
+          /*
+           * The sequence numbers are the same and the route is active: the sender is one more next hop
+           * to the destination and is added to the pheromone table. It becomes the current next hop if
+           * (iv) the New Hop Count is smaller than the hop count in route table entry.
+           */
+          else if (bantHeader.GetDstSeqno () == toDst.GetSeqNo ())
             {
-              m_routingTable.Update (newEntry);
+              Ipv4InterfaceAddress iface = m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0);
+              toDst.AddNextHop (sender, dev, iface,
+                                RoutingTableEntry::GetInitialPheromone (hops),
+                                bantHeader.GetLifeTime ());
+              if (hops < toDst.GetHop ())
+                {
+                  toDst.SetHop (hops);
+                  toDst.SetNextHop (sender);
+                  toDst.SetOutputDevice (dev);
+                  toDst.SetInterface (iface);
+                  toDst.SetLifeTime (std::max (bantHeader.GetLifeTime (), toDst.GetLifeTime ()));
+                }
+              m_routingTable.Update (toDst);
             }
         }
     }
@@ -1600,22 +2079,36 @@ RoutingProtocol::RecvReply (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sen
   toOrigin.SetLifeTime (std::max (m_activeRouteTimeout, toOrigin.GetLifeTime ()));
   m_routingTable.Update (toOrigin);
 
+  /*
+   * In multipath route discovery the BANTs answering one FANT take its recorded previous hops
+   * in round robin, spreading the replies over the reverse paths known here rather than sending
+   * them all along the primary one.
+   */
+  Ipv4Address prevHop = toOrigin.GetNextHop ();
+  Ipv4Address reverseHop;
+  if (m_multipathDiscovery && bantHeader.GetFantId () != 0
+      && m_fantPathCache.NextReverseHop (bantHeader.GetOrigin (), bantHeader.GetFantId (), reverseHop)
+      && toOrigin.HasNextHop (reverseHop))
+    {
+      prevHop = reverseHop;
+    }
+
   // Update information about precursors
   if (m_routingTable.LookupValidRoute (bantHeader.GetDst (), toDst))
     {
-      toDst.InsertPrecursor (toOrigin.GetNextHop ());
+      toDst.InsertPrecursor (prevHop);
       m_routingTable.Update (toDst);
 
       RoutingTableEntry toNextHopToDst;
       m_routingTable.LookupRoute (toDst.GetNextHop (), toNextHopToDst);
-      toNextHopToDst.InsertPrecursor (toOrigin.GetNextHop ());
+      toNextHopToDst.InsertPrecursor (prevHop);
       m_routingTable.Update (toNextHopToDst);
 
       toOrigin.InsertPrecursor (toDst.GetNextHop ());
       m_routingTable.Update (toOrigin);
 
       RoutingTableEntry toNextHopToOrigin;
-      m_routingTable.LookupRoute (toOrigin.GetNextHop (), toNextHopToOrigin);
+      m_routingTable.LookupRoute (prevHop, toNextHopToOrigin);
       toNextHopToOrigin.InsertPrecursor (toDst.GetNextHop ());
       m_routingTable.Update (toNextHopToOrigin);
     }
@@ -1636,7 +2129,7 @@ RoutingProtocol::RecvReply (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sen
   packet->AddHeader (tHeader);
   Ptr<Socket> socket = FindSocketWithInterfaceAddress (toOrigin.GetInterface ());
   NS_ASSERT (socket);
-  socket->SendTo (packet, 0, InetSocketAddress (toOrigin.GetNextHop (), AODV_PORT));
+  socket->SendTo (packet, 0, InetSocketAddress (prevHop, AODV_PORT));
 }
 
 void
@@ -1667,7 +2160,7 @@ RoutingProtocol::ProcessHello (BANTHeader const & bantHeader, Ipv4Address receiv
       Ptr<NetDevice> dev = m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver));
       RoutingTableEntry newEntry (/*device=*/ dev, /*dst=*/ bantHeader.GetDst (), /*validSeqNo=*/ true, /*seqno=*/ bantHeader.GetDstSeqno (),
                                               /*iface=*/ m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),
-                                              /*pheromone=*/ 1, /*nextHop=*/ bantHeader.GetDst (), /*lifeTime=*/ bantHeader.GetLifeTime ());
+                                              /*hops=*/ 1, /*nextHop=*/ bantHeader.GetDst (), /*lifeTime=*/ bantHeader.GetLifeTime ());
       m_routingTable.AddRoute (newEntry);
     }
   else
@@ -1678,8 +2171,12 @@ RoutingProtocol::ProcessHello (BANTHeader const & bantHeader, Ipv4Address receiv
       toNeighbor.SetFlag (VALID);
       toNeighbor.SetOutputDevice (m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver)));
       toNeighbor.SetInterface (m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0));
-      toNeighbor.SetPheromone (1);
+      toNeighbor.SetHop (1);
       toNeighbor.SetNextHop (bantHeader.GetDst ());
+      toNeighbor.AddNextHop (bantHeader.GetDst (), m_ipv4->GetNetDevice (m_ipv4->GetInterfaceForAddress (receiver)),
+                             m_ipv4->GetAddress (m_ipv4->GetInterfaceForAddress (receiver), 0),
+                             RoutingTableEntry::GetInitialPheromone (1),
+                             toNeighbor.GetLifeTime ());
       m_routingTable.Update (toNeighbor);
     }
   if (m_enableHello)
@@ -1700,17 +2197,13 @@ RoutingProtocol::RecvError (Ptr<Packet> p, Ipv4Address src )
   std::pair<Ipv4Address, uint32_t> un;
   while (rerrHeader.RemoveUnDestination (un))
     {
-      for (std::map<Ipv4Address, uint32_t>::const_iterator i =
-             dstWithNextHopSrc.begin (); i != dstWithNextHopSrc.end (); ++i)
+      if (dstWithNextHopSrc.find (un.first) != dstWithNextHopSrc.end ())
         {
-          if (i->first == un.first)
-            {
-              unreachable.insert (un);
-            }
+          unreachable.insert (un);
         }
     }
 
-  std::vector<Ipv4Address> precursors;
+  NodeIdSet precursors;
   for (std::map<Ipv4Address, uint32_t>::const_iterator i = unreachable.begin ();
        i != unreachable.end (); )
     {
@@ -1728,9 +2221,11 @@ RoutingProtocol::RecvError (Ptr<Packet> p, Ipv4Address src )
         }
       else
         {
-          RoutingTableEntry toDst;
-          m_routingTable.LookupRoute (i->first, toDst);
-          toDst.GetPrecursors (precursors);
+          RoutingTableEntry const* toDst = m_routingTable.FindRoute (i->first);
+          if (toDst != 0)
+            {
+              toDst->GetPrecursors (precursors);
+            }
           ++i;
         }
     }
@@ -1776,7 +2271,7 @@ RoutingProtocol::RouteRequestTimerExpire (Ipv4Address dst)
 
   if (toDst.GetFlag () == IN_SEARCH)
     {
-      NS_LOG_LOGIC ("Resend RREQ to " << dst << " previous ttl " << toDst.GetPheromone ());
+      NS_LOG_LOGIC ("Resend RREQ to " << dst << " previous ttl " << toDst.GetHop ());
       SendRequest (dst);
     }
   else
@@ -1873,32 +2368,72 @@ void
 RoutingProtocol::SendPacketFromQueue (Ipv4Address dst, Ptr<Ipv4Route> route)
 {
   NS_LOG_FUNCTION (this);
-  QueueEntry queueEntry;
-  while (m_queue.Dequeue (dst, queueEntry))
+  std::vector<QueueEntry> queueEntries;
+  m_queue.DequeueAll (dst, queueEntries);
+  for (std::vector<QueueEntry>::const_iterator i = queueEntries.begin (); i != queueEntries.end (); ++i)
     {
       DeferredRouteOutputTag tag;
-      Ptr<Packet> p = ConstCast<Packet> (queueEntry.GetPacket ());
-      if (p->RemovePacketTag (tag)
-          && tag.GetInterface () != -1
+      Ptr<Packet> p = ConstCast<Packet> (i->GetPacket ());
+      UnicastForwardCallback const & ucb = i->GetUnicastForwardCallback ();
+      Ipv4Header header = i->GetIpv4Header ();
+      if (!p->RemovePacketTag (tag))
+        {
+          // Salvaged packet of another source, it keeps its header
+          ++m_salvagedPacketsSent;
+          ucb (route, p, header);
+          continue;
+        }
+      if (tag.GetInterface () != -1
           && tag.GetInterface () != m_ipv4->GetInterfaceForDevice (route->GetOutputDevice ()))
         {
           NS_LOG_DEBUG ("Output device doesn't match. Dropped.");
-          return;
+          i->GetErrorCallback () (p, header, Socket::ERROR_NOROUTETOHOST);
+          continue;
         }
-      UnicastForwardCallback ucb = queueEntry.GetUnicastForwardCallback ();
-      Ipv4Header header = queueEntry.GetIpv4Header ();
       header.SetSource (route->GetSource ());
       header.SetTtl (header.GetTtl () + 1); // compensate extra TTL decrement by fake loopback routing
       ucb (route, p, header);
     }
 }
 
+void
+RoutingProtocol::UpdateLinkQuality (Ipv4Address nextHop, double quality)
+{
+  NS_LOG_FUNCTION (this << nextHop << quality);
+  m_routingTable.SetLinkQuality (nextHop, quality);
+}
+
+void
+RoutingProtocol::HandleLinkFailure (Ipv4Address nextHop)
+{
+  NS_LOG_FUNCTION (this << nextHop);
+  SendRerrWhenBreaksLinkToNextHop (nextHop);
+  // Routes through the next hop are gone or switched over by now
+  std::vector<QueueEntry> entries;
+  m_retransmitBuffer.RemoveAll (nextHop, entries);
+  for (std::vector<QueueEntry>::const_iterator i = entries.begin (); i != entries.end (); ++i)
+    {
+      Reroute (*i);
+    }
+}
+
+void
+RoutingProtocol::ProcessTxStatus (Ipv4Address nextHop, bool delivered)
+{
+  NS_LOG_FUNCTION (this << nextHop << delivered);
+  QueueEntry entry;
+  if (m_retransmitBuffer.Remove (nextHop, entry) && !delivered)
+    {
+      Reroute (entry);
+    }
+}
+
 void
 RoutingProtocol::SendRerrWhenBreaksLinkToNextHop (Ipv4Address nextHop)
 {
   NS_LOG_FUNCTION (this << nextHop);
   RerrHeader rerrHeader;
-  std::vector<Ipv4Address> precursors;
+  NodeIdSet precursors;
   std::map<Ipv4Address, uint32_t> unreachable;
 
   RoutingTableEntry toNextHop;
@@ -1906,9 +2441,37 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop (Ipv4Address nextHop)
     {
       return;
     }
-  toNextHop.GetPrecursors (precursors);
-  rerrHeader.AddUnDestination (nextHop, toNextHop.GetSeqNo ());
-  m_routingTable.GetListOfDestinationWithNextHop (nextHop, unreachable);
+  bool nextHopLost = true;
+  if (m_localFailover)
+    {
+      /*
+       * Routes with another next hop left switch over at once and are not reported.
+       * Their queued packets are sent on here; HandleLinkFailure then routes the packets
+       * still with the MAC for the next hop again, over the switched routes.
+       */
+      std::vector<Ipv4Address> switched;
+      m_routingTable.FailOverNextHop (nextHop, unreachable, switched);
+      for (std::vector<Ipv4Address>::const_iterator i = switched.begin (); i != switched.end (); ++i)
+        {
+          RoutingTableEntry const * toDst = m_routingTable.FindRoute (*i);
+          SendPacketFromQueue (*i, toDst->GetRoute ());
+          nextHopLost = nextHopLost && *i != nextHop;
+        }
+      m_localFailovers += switched.size ();
+      if (unreachable.empty () && !nextHopLost)
+        {
+          return;
+        }
+    }
+  else
+    {
+      m_routingTable.GetListOfDestinationWithNextHop (nextHop, unreachable);
+    }
+  if (nextHopLost)
+    {
+      toNextHop.GetPrecursors (precursors);
+      rerrHeader.AddUnDestination (nextHop, toNextHop.GetSeqNo ());
+    }
   for (std::map<Ipv4Address, uint32_t>::const_iterator i = unreachable.begin (); i
        != unreachable.end (); )
     {
@@ -1927,9 +2490,11 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop (Ipv4Address nextHop)
         }
       else
         {
-          RoutingTableEntry toDst;
-          m_routingTable.LookupRoute (i->first, toDst);
-          toDst.GetPrecursors (precursors);
+          RoutingTableEntry const* toDst = m_routingTable.FindRoute (i->first);
+          if (toDst != 0)
+            {
+              toDst->GetPrecursors (precursors);
+            }
           ++i;
         }
     }
@@ -1944,7 +2509,10 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop (Ipv4Address nextHop)
       packet->AddHeader (typeHeader);
       SendRerrMessage (packet, precursors);
     }
-  unreachable.insert (std::make_pair (nextHop, toNextHop.GetSeqNo ()));
+  if (nextHopLost)
+    {
+      unreachable.insert (std::make_pair (nextHop, toNextHop.GetSeqNo ()));
+    }
   m_routingTable.InvalidateRoutesWithDst (unreachable);
 }
 
@@ -2005,6 +2573,14 @@ RoutingProtocol::SendRerrWhenNoRouteToForward (Ipv4Address dst,
     }
 }
 
+void
+RoutingProtocol::SendRerrMessage (Ptr<Packet> packet, NodeIdSet const & precursors)
+{
+  std::vector<Ipv4Address> addresses;
+  precursors.GetAddresses (addresses);
+  SendRerrMessage (packet, addresses);
+}
+
 void
 RoutingProtocol::SendRerrMessage (Ptr<Packet> packet, std::vector<Ipv4Address> precursors)
 {
@@ -29,6 +29,7 @@
 #define ARAROUTINGPROTOCOL_H
 
 #include "ara-rtable.h"
+#include "ara-route-cache.h"
 #include "ara-rqueue.h"
 #include "ara-packet.h"
 #include "ara-neighbor.h"
@@ -41,6 +42,7 @@
 #include "ns3/ipv4-l3-protocol.h"
 #include <map>
 
+
 namespace ns3 {
 namespace ara {
 /**
@@ -102,6 +104,32 @@ public:
    * \param len the maximum queue length
    */
   void SetMaxQueueLen (uint32_t len);
+  /**
+   * Get the maximum number of queued bytes
+   * \returns the maximum number of queued bytes
+   */
+  uint32_t GetMaxQueueBytes () const
+  {
+    return m_maxQueueBytes;
+  }
+  /**
+   * Set the maximum number of queued bytes
+   * \param bytes the maximum number of queued bytes
+   */
+  void SetMaxQueueBytes (uint32_t bytes);
+  /**
+   * Get the maximum queue length per destination
+   * \returns the maximum queue length per destination
+   */
+  uint32_t GetMaxQueueLenPerDestination () const
+  {
+    return m_maxQueueLenPerDst;
+  }
+  /**
+   * Set the maximum queue length per destination
+   * \param len the maximum queue length per destination
+   */
+  void SetMaxQueueLenPerDestination (uint32_t len);
   /**
    * Get destination only flag
    * \returns the destination only flag
@@ -166,6 +194,311 @@ public:
   {
     return m_enableBroadcast;
   }
+  /**
+   * Set probabilistic forwarding flag
+   * \param f the probabilistic forwarding flag
+   */
+  void SetProbabilisticForwarding (bool f)
+  {
+    m_probabilisticForwarding = f;
+  }
+  /**
+   * Get probabilistic forwarding flag
+   * \returns the probabilistic forwarding flag
+   */
+  bool GetProbabilisticForwarding () const
+  {
+    return m_probabilisticForwarding;
+  }
+  /**
+   * Set local failover flag.  On a link break, routes with another next hop switch to
+   * it and send their queued packets on.  Forwarded packets already handed to the MAC
+   * for the broken link are routed again as well, if packet salvaging is enabled and
+   * they are still in the retransmit buffer; packets originated by this node are not.
+   * \param f the local failover flag
+   */
+  void SetLocalFailover (bool f)
+  {
+    m_localFailover = f;
+  }
+  /**
+   * Get local failover flag
+   * \returns the local failover flag
+   */
+  bool GetLocalFailover () const
+  {
+    return m_localFailover;
+  }
+  /**
+   * \returns the number of routes switched to another next hop on a link break instead of being invalidated
+   */
+  uint32_t GetLocalFailovers () const
+  {
+    return m_localFailovers;
+  }
+  /**
+   * Set packet salvaging flag
+   * \param f the packet salvaging flag
+   */
+  void SetPacketSalvaging (bool f)
+  {
+    m_packetSalvaging = f;
+  }
+  /**
+   * Get packet salvaging flag
+   * \returns the packet salvaging flag
+   */
+  bool GetPacketSalvaging () const
+  {
+    return m_packetSalvaging;
+  }
+  /**
+   * \returns the number of forwarded packets held for salvaging after their route broke
+   */
+  uint32_t GetSalvagedPackets () const
+  {
+    return m_salvagedPackets;
+  }
+  /**
+   * \returns the number of salvaged packets sent on after a route was found again
+   */
+  uint32_t GetSalvagedPacketsSent () const
+  {
+    return m_salvagedPacketsSent;
+  }
+  /**
+   * Set the number of forwarded packets per next hop remembered for routing them again
+   * \param len the number of packets, 0 disables routing packets again
+   */
+  void SetRetransmitBufferLen (uint32_t len);
+  /**
+   * \returns the number of forwarded packets per next hop remembered for routing them again
+   */
+  uint32_t GetRetransmitBufferLen () const
+  {
+    return m_retransmitBufferLen;
+  }
+  /**
+   * Set the time a forwarded packet is remembered for routing it again
+   * \param t the time
+   */
+  void SetRetransmitBufferTimeout (Time t);
+  /**
+   * \returns the time a forwarded packet is remembered for routing it again
+   */
+  Time GetRetransmitBufferTimeout () const
+  {
+    return m_retransmitBufferTimeout;
+  }
+  /**
+   * \returns the number of forwarded packets routed again after the MAC dropped them or their link broke
+   */
+  uint32_t GetReroutedPackets () const
+  {
+    return m_reroutedPackets;
+  }
+  /**
+   * Set multipath route discovery flag
+   * \param f the multipath route discovery flag
+   */
+  void SetMultipathDiscovery (bool f)
+  {
+    m_multipathDiscovery = f;
+  }
+  /**
+   * Get multipath route discovery flag
+   * \returns the multipath route discovery flag
+   */
+  bool GetMultipathDiscovery () const
+  {
+    return m_multipathDiscovery;
+  }
+  /**
+   * Set the pheromone evaporation curve
+   * \param decay the pheromone evaporation curve
+   */
+  void SetPheromoneDecay (PheromoneDecay decay);
+  /**
+   * Get the pheromone evaporation curve
+   * \returns the pheromone evaporation curve
+   */
+  PheromoneDecay GetPheromoneDecay () const
+  {
+    return m_pheromoneDecay;
+  }
+  /**
+   * Set the pheromone evaporation rate
+   * \param rate the evaporated fraction (exponential) or amount (linear) per second
+   */
+  void SetEvaporationRate (double rate);
+  /**
+   * Get the pheromone evaporation rate
+   * \returns the pheromone evaporation rate
+   */
+  double GetEvaporationRate () const
+  {
+    return m_evaporationRate;
+  }
+  /**
+   * Set the pheromone deposited by data traffic on the next hop that carries it
+   * \param deposit the amount per reinforcement interval, 0 disables reinforcement
+   */
+  void SetPheromoneDeposit (double deposit);
+  /**
+   * Get the pheromone deposited by data traffic on the next hop that carries it
+   * \returns the amount per reinforcement interval
+   */
+  double GetPheromoneDeposit () const
+  {
+    return m_pheromoneDeposit;
+  }
+  /**
+   * Set the minimum time between two deposits of data traffic on the same next hop
+   * \param t the reinforcement interval
+   */
+  void SetReinforcementInterval (Time t);
+  /**
+   * Get the minimum time between two deposits of data traffic on the same next hop
+   * \returns the reinforcement interval
+   */
+  Time GetReinforcementInterval () const
+  {
+    return m_reinforcementInterval;
+  }
+  /**
+   * Set the weight of a new transmission attempt in the link delivery ratio estimate
+   * \param weight the weight, in [0, 1], 0 disables the estimate
+   */
+  void SetLinkQualityWeight (double weight);
+  /**
+   * Get the weight of a new transmission attempt in the link delivery ratio estimate
+   * \returns the weight
+   */
+  double GetLinkQualityWeight () const
+  {
+    return m_linkQualityWeight;
+  }
+  /**
+   * Set the number of frames to a neighbor the MAC may drop in a row before the link breaks
+   * \param errors the number of frames, at least 1
+   */
+  void SetMaxTxErrors (uint32_t errors);
+  /**
+   * Get the number of frames to a neighbor the MAC may drop in a row before the link breaks
+   * \returns the number of frames
+   */
+  uint32_t GetMaxTxErrors () const
+  {
+    return m_maxTxErrors;
+  }
+  /**
+   * Set the delivery ratio estimate below which a frame dropped by the MAC breaks the link
+   * \param threshold the delivery ratio, 0 disables breaking links on the estimate
+   */
+  void SetLinkQualityThreshold (double threshold);
+  /**
+   * Get the delivery ratio estimate below which a frame dropped by the MAC breaks the link
+   * \returns the delivery ratio
+   */
+  double GetLinkQualityThreshold () const
+  {
+    return m_linkQualityThreshold;
+  }
+  /**
+   * Set the number of route cache slots
+   * \param size the number of slots, zero disables the cache
+   */
+  void SetRouteCacheSize (uint32_t size);
+  /**
+   * Get the number of route cache slots
+   * \returns the number of slots
+   */
+  uint32_t GetRouteCacheSize () const
+  {
+    return m_routeCacheSize;
+  }
+  /**
+   * Set the interval between lifetime refreshes of a cached route
+   * \param t the refresh interval
+   */
+  void SetRouteCacheRefreshInterval (Time t);
+  /**
+   * Get the interval between lifetime refreshes of a cached route
+   * \returns the refresh interval
+   */
+  Time GetRouteCacheRefreshInterval () const
+  {
+    return m_routeCacheRefreshInterval;
+  }
+  /**
+   * Set how FANT IDs are remembered for duplicate detection
+   * \param mode the ID cache mode
+   */
+  void SetFantIdCacheMode (IdCacheMode mode);
+  /**
+   * Get how FANT IDs are remembered for duplicate detection
+   * \returns the ID cache mode
+   */
+  IdCacheMode GetFantIdCacheMode () const
+  {
+    return m_fantIdCacheMode;
+  }
+  /**
+   * Set how broadcast data packets are remembered for duplicate detection
+   * \param mode the duplicate detection mode
+   */
+  void SetDuplicateDetectionMode (DuplicateDetectionMode mode);
+  /**
+   * Get how broadcast data packets are remembered for duplicate detection
+   * \returns the duplicate detection mode
+   */
+  DuplicateDetectionMode GetDuplicateDetectionMode () const
+  {
+    return m_dpdMode;
+  }
+  /**
+   * Set the expected number of broadcast data packets per PathDiscoveryTime, which sizes the Bloom filters
+   * \param packets the expected number of packets
+   */
+  void SetDuplicateDetectionPackets (uint32_t packets);
+  /**
+   * Get the expected number of broadcast data packets per PathDiscoveryTime
+   * \returns the expected number of packets
+   */
+  uint32_t GetDuplicateDetectionPackets () const
+  {
+    return m_dpdPackets;
+  }
+  /**
+   * Set the false positive rate of duplicate detection with both Bloom filters at the expected number of packets
+   * \param rate the false positive rate
+   */
+  void SetDuplicateDetectionFalsePositiveRate (double rate);
+  /**
+   * Get the false positive rate of duplicate detection with both Bloom filters at the expected number of packets
+   * \returns the false positive rate
+   */
+  double GetDuplicateDetectionFalsePositiveRate () const
+  {
+    return m_dpdFalsePositiveRate;
+  }
+  /**
+   * \returns the approximate number of bytes used to remember broadcast data packets
+   */
+  uint32_t GetDuplicateDetectionMemoryUsage ();
+  /**
+   * \returns the number of broadcast data packets dropped as duplicates
+   */
+  uint64_t GetDuplicatePackets () const;
+  /**
+   * \returns the false positive rate of duplicate detection, estimated from the Bloom filter fill, not measured
+   */
+  double GetDuplicateDetectionEstimatedFalsePositiveRate () const;
+  /**
+   * \returns the number of times a full Bloom filter forced duplicate detection to forget packets
+   *          before PathDiscoveryTime; a nonzero count means DuplicateDetectionPackets is too low
+   */
+  uint64_t GetDuplicateDetectionEarlyRotations () const;
 
   /**
    * Assign a fixed random variable stream number to the random variables
@@ -213,10 +546,33 @@ private:
   Time m_blackListTimeout;             ///< Time for which the node is put into the blacklist
   uint32_t m_maxQueueLen;              ///< The maximum number of packets that we allow a routing protocol to buffer.
   Time m_maxQueueTime;                 ///< The maximum period of time that a routing protocol is allowed to buffer a packet for.
+  uint32_t m_maxQueueBytes;            ///< The maximum number of bytes that we allow a routing protocol to buffer.
+  uint32_t m_maxQueueLenPerDst;        ///< The maximum number of packets buffered per destination.
   bool m_destinationOnly;              ///< Indicates only the destination may respond to this RREQ.
   bool m_gratuitousReply;              ///< Indicates whether a gratuitous RREP should be unicast to the node originated route discovery.
   bool m_enableHello;                  ///< Indicates whether a hello messages enable
   bool m_enableBroadcast;              ///< Indicates whether a a broadcast data packets forwarding enable
+  bool m_probabilisticForwarding;      ///< Indicates whether data packets are spread over next hops in proportion to pheromone
+  bool m_multipathDiscovery;           ///< Indicates whether copies of a FANT from other previous hops add reverse paths
+  bool m_localFailover;                ///< Indicates whether routes switch to another next hop on a link break
+  bool m_packetSalvaging;              ///< Indicates whether forwarded packets without a valid route are buffered
+  Time m_salvageTimeout;               ///< The maximum period of time a forwarded packet is buffered for salvaging
+  uint32_t m_retransmitBufferLen;      ///< The maximum number of forwarded packets per next hop remembered for routing them again
+  Time m_retransmitBufferTimeout;      ///< The time a forwarded packet is remembered for routing it again
+  uint32_t m_maxDiscoveryPaths;        ///< Maximum number of reverse paths learned from one FANT
+  PheromoneDecay m_pheromoneDecay;     ///< Pheromone evaporation curve
+  double m_evaporationRate;            ///< Evaporated fraction (exponential) or amount (linear) of pheromone per second
+  double m_pheromoneDeposit;           ///< Pheromone deposited by data traffic on a next hop per reinforcement interval
+  Time m_reinforcementInterval;        ///< Minimum time between two deposits of data traffic on the same next hop
+  uint32_t m_routeCacheSize;           ///< Number of route cache slots
+  Time m_routeCacheRefreshInterval;    ///< Interval between lifetime refreshes of a cached route
+  IdCacheMode m_fantIdCacheMode;       ///< How FANT IDs are remembered for duplicate detection
+  DuplicateDetectionMode m_dpdMode;    ///< How broadcast data packets are remembered for duplicate detection
+  uint32_t m_dpdPackets;               ///< Expected number of broadcast data packets per PathDiscoveryTime
+  double m_dpdFalsePositiveRate;       ///< False positive rate of duplicate detection with both Bloom filters at the expected number of packets
+  double m_linkQualityWeight;          ///< Weight of a new transmission attempt in the link delivery ratio estimate
+  uint32_t m_maxTxErrors;              ///< Number of frames to a neighbor the MAC may drop in a row before the link breaks
+  double m_linkQualityThreshold;       ///< Delivery ratio estimate below which a dropped frame breaks the link
   //\}
 
   /// IP protocol
@@ -230,14 +586,20 @@ private:
 
   /// Routing table
   RoutingTable m_routingTable;
+  /// Routes of locally originated flows, invalidated by m_routingTable
+  RouteCache m_routeCache;
   /// A "drop-front" queue used by the routing layer to buffer packets to which it does not have a route.
   RequestQueue m_queue;
+  /// Forwarded packets recently handed to the MAC, to route them again if they do not leave the node
+  RetransmitBuffer m_retransmitBuffer;
   /// Broadcast ID
   uint32_t m_requestId;
   /// Request sequence number
   uint32_t m_seqNo;
   /// Handle duplicated RREQ
   IdCache m_rreqIdCache;
+  /// Previous hops of recent FANTs, for multipath route discovery
+  FantPathCache m_fantPathCache;
   /// Handle duplicated broadcast/multicast packets
   DuplicatePacketDetection m_dpd;
   /// Handle neighbors
@@ -246,6 +608,14 @@ private:
   uint16_t m_rreqCount;
   /// Number of RERRs used for RERR rate control
   uint16_t m_rerrCount;
+  /// Number of routes switched to another next hop on a link break
+  uint32_t m_localFailovers;
+  /// Number of forwarded packets held for salvaging
+  uint32_t m_salvagedPackets;
+  /// Number of salvaged packets sent on
+  uint32_t m_salvagedPacketsSent;
+  /// Number of forwarded packets routed again
+  uint32_t m_reroutedPackets;
 
 private:
   /// Start protocol operation
@@ -259,6 +629,18 @@ private:
    * \param ecb the ErrorCallback function
    */ 
   void DeferredRouteOutput (Ptr<const Packet> p, const Ipv4Header & header, UnicastForwardCallback ucb, ErrorCallback ecb);
+  /**
+   * Buffer a forwarded packet whose route is not valid for at most the salvage timeout,
+   * and start a local route discovery unless one is running.
+   * The packet is sent on when the route is repaired or rediscovered.
+   *
+   * \param p the packet to route
+   * \param header the IP header
+   * \param ucb the UnicastForwardCallback function
+   * \param ecb the ErrorCallback function
+   * \returns true if the packet is buffered; otherwise ecb has not been called
+   */
+  bool SalvagePacket (Ptr<const Packet> p, const Ipv4Header & header, UnicastForwardCallback ucb, ErrorCallback ecb);
   /**
    * If route exists and is valid, forward packet.
    *
@@ -266,9 +648,18 @@ private:
    * \param header the IP header
    * \param ucb the UnicastForwardCallback function
    * \param ecb the ErrorCallback function
+   * \param rerouted whether the packet is routed again, in which case it is not remembered for another attempt
    * \returns true if forwarded
    */ 
-  bool Forwarding (Ptr<const Packet> p, const Ipv4Header & header, UnicastForwardCallback ucb, ErrorCallback ecb);
+  bool Forwarding (Ptr<const Packet> p, const Ipv4Header & header, UnicastForwardCallback ucb, ErrorCallback ecb,
+                   bool rerouted = false);
+  /**
+   * Route a forwarded packet again after it was lost on the way to its next hop,
+   * dropping it through its error callback if that fails
+   *
+   * \param entry the packet, its IP header and callbacks
+   */
+  void Reroute (QueueEntry const & entry);
   /**
    * Repeated attempts by a source node at route discovery for a single destination
    * use the expanding ring search technique.
@@ -279,9 +670,19 @@ private:
    * Set lifetime field in routing table entry to the maximum of existing lifetime and lt, if the entry exists
    * \param addr - destination address
    * \param lt - proposed time for lifetime field in routing table entry for destination with address addr.
+   * \param nextHop - next hop that carried a data packet, whose pheromone record is refreshed and reinforced as well;
+   *                  if not given the record of the current next hop is only refreshed
    * \return true if route to destination address addr exist
    */
-  bool UpdateRouteLifeTime (Ipv4Address addr, Time lt);
+  bool UpdateRouteLifeTime (Ipv4Address addr, Time lt, Ipv4Address nextHop = Ipv4Address ());
+  /**
+   * Choose the route used to send a data packet to the destination of rt:
+   * the current route, or a next hop drawn in proportion to pheromone if
+   * probabilistic forwarding is enabled.
+   * \param rt the routing table entry of the destination
+   * \returns the route
+   */
+  Ptr<Ipv4Route> SelectRoute (RoutingTableEntry const & rt);
   /**
    * Update neighbor record.
    * \param receiver is supposed to be my interface
@@ -330,6 +731,15 @@ private:
   void RecvAodv (Ptr<Socket> socket);
   /// Receive FANT
   void RecvRequest (Ptr<Packet> p, Ipv4Address receiver, Ipv4Address src);
+  /**
+   * Receive a later copy of a FANT in multipath route discovery: add the
+   * reverse path through its previous hop and, at the destination, answer
+   * it with a BANT along that path. The copy is not rebroadcast.
+   * \param fantHeader the FANT header
+   * \param receiver the address of the receiving interface
+   * \param src the previous hop
+   */
+  void RecvAlternativeRequest (FANTHeader const & fantHeader, Ipv4Address receiver, Ipv4Address src);
   /// Receive RREP
   void RecvReply (Ptr<Packet> p, Ipv4Address my,Ipv4Address src);
   /// Receive RREP_ACK
@@ -348,6 +758,17 @@ private:
   void SendRequest (Ipv4Address dst);
   /// Send FANT
   void SendReply (FANTHeader const & fantHeader, RoutingTableEntry const & toOrigin);
+  /**
+   * Send BANT as destination along a given reverse path.  The BANT carries
+   * the FANT ID, so that each relay passes it on over a reverse path of its own.
+   * \param fantHeader the FANT header
+   * \param origin the origin of the FANT
+   * \param nextHop the next hop towards origin
+   * \param iface the interface to reach nextHop
+   * \param hops the length of the path to origin
+   */
+  void SendReply (FANTHeader const & fantHeader, Ipv4Address origin, Ipv4Address nextHop,
+                  Ipv4InterfaceAddress iface, uint16_t hops);
   /** Send RREP by intermediate node
    * \param toDst routing table entry to destination
    * \param toOrigin routing table entry to originator
@@ -356,10 +777,33 @@ private:
   void SendReplyByIntermediateNode (RoutingTableEntry & toDst, RoutingTableEntry & toOrigin, bool gratRep);
   /// Send RREP_ACK
   void SendReplyAck (Ipv4Address neighbor);
+  /**
+   * Report a broken link in a RERR, then route the packets still with the MAC for the
+   * next hop again
+   * \param nextHop the neighbor
+   */
+  void HandleLinkFailure (Ipv4Address nextHop);
   /// Initiate RERR
   void SendRerrWhenBreaksLinkToNextHop (Ipv4Address nextHop);
+  /**
+   * Process the outcome of a frame to a neighbor.  Frames to one neighbor leave the MAC
+   * in order, so it is matched to the oldest packet forwarded to it, and a dropped one is
+   * routed again.  Unicast control packets to the neighbor are not remembered and can
+   * shift the match by a packet or two.
+   * \param nextHop the neighbor
+   * \param delivered whether the frame was acknowledged
+   */
+  void ProcessTxStatus (Ipv4Address nextHop, bool delivered);
+  /**
+   * Scale the pheromone read for a next hop by the delivery ratio of the link to it
+   * \param nextHop the neighbor
+   * \param quality the delivery ratio estimate
+   */
+  void UpdateLinkQuality (Ipv4Address nextHop, double quality);
   /// Forward RERR
   void SendRerrMessage (Ptr<Packet> packet,  std::vector<Ipv4Address> precursors);
+  /// Forward RERR to a set of precursors
+  void SendRerrMessage (Ptr<Packet> packet, NodeIdSet const & precursors);
   /**
    * Send RERR message when no route to forward input packet. Unicast if there is reverse route to originating node, broadcast otherwise.
    * \param dst - destination node IP address
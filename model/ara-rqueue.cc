@@ -27,7 +27,6 @@
  */
 #include "ara-rqueue.h"
 #include <algorithm>
-#include <functional>
 #include "ns3/ipv4-route.h"
 #include "ns3/socket.h"
 #include "ns3/log.h"
@@ -37,125 +36,486 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("AraRequestQueue");
 
 namespace ara {
+
+const uint32_t RequestQueue::NONE;
+
+/**
+ * \param a a callback
+ * \param b another callback
+ * \returns true if both are null or both invoke the same target
+ */
+static bool
+SameCallback (CallbackBase const & a, CallbackBase const & b)
+{
+  // Callback::IsEqual dereferences its implementation, so test null first
+  Ptr<CallbackImplBase> impl = a.GetImpl ();
+  if (impl == 0 || b.GetImpl () == 0)
+    {
+      return impl == b.GetImpl ();
+    }
+  return impl->IsEqual (b.GetImpl ());
+}
+
 uint32_t
 RequestQueue::GetSize ()
 {
   Purge ();
-  return m_queue.size ();
+  return m_records.size () - m_freeRecords.size ();
+}
+
+uint32_t
+RequestQueue::GetBytes ()
+{
+  Purge ();
+  return m_bytes;
+}
+
+uint32_t
+RequestQueue::GetCallbackSlotsInUse () const
+{
+  uint32_t used = 0;
+  for (std::vector<SharedCallbacks>::const_iterator i = m_callbacks.begin (); i != m_callbacks.end (); ++i)
+    {
+      if (i->users != 0)
+        {
+          ++used;
+        }
+    }
+  return used;
 }
 
 bool
 RequestQueue::Enqueue (QueueEntry & entry)
+{
+  return Enqueue (entry, Time::Max ());
+}
+
+bool
+RequestQueue::Enqueue (QueueEntry & entry, Time timeout)
 {
   Purge ();
-  for (std::vector<QueueEntry>::const_iterator i = m_queue.begin (); i
-       != m_queue.end (); ++i)
+  if (m_keys.count (GetKey (entry.GetPacket (), entry.GetIpv4Header ())) != 0)
     {
-      if ((i->GetPacket ()->GetUid () == entry.GetPacket ()->GetUid ())
-          && (i->GetIpv4Header ().GetDestination ()
-              == entry.GetIpv4Header ().GetDestination ()))
+      return false;
+    }
+  uint32_t bytes = entry.GetPacket ()->GetSize ();
+  if (m_maxBytes != 0 && bytes > m_maxBytes)
+    {
+      Drop (entry, "Drop packet larger than the queue ");
+      return false;
+    }
+  entry.SetExpireTime (std::min (timeout, m_queueTimeout));
+  if (m_maxLenPerDst != 0)
+    {
+      std::unordered_map<uint32_t, DestinationQueue>::const_iterator d =
+        m_destinations.find (entry.GetIpv4Header ().GetDestination ().Get ());
+      if (d != m_destinations.end () && d->second.size >= m_maxLenPerDst)
         {
-          return false;
+          uint32_t oldest = d->second.oldest;
+          DropRecord (oldest, "Drop the most aged packet of the destination ");
         }
     }
-  entry.SetExpireTime (m_queueTimeout);
-  if (m_queue.size () == m_maxLen)
+  while (m_oldest != NONE && !HasRoom (bytes))
     {
-      Drop (m_queue.front (), "Drop the most aged packet"); // Drop the most aged packet
-      m_queue.erase (m_queue.begin ());
+      DropFromLargestBacklog ();
     }
-  m_queue.push_back (entry);
+  Link (entry, timeout);
   return true;
 }
 
+void
+RequestQueue::SetMaxQueueLen (uint32_t len)
+{
+  m_maxLen = len;
+  m_records.reserve (len);
+  while (m_oldest != NONE && m_records.size () - m_freeRecords.size () > m_maxLen)
+    {
+      DropFromLargestBacklog ();
+    }
+}
+
+void
+RequestQueue::SetMaxQueueBytes (uint32_t bytes)
+{
+  m_maxBytes = bytes;
+  while (m_maxBytes != 0 && m_bytes > m_maxBytes)
+    {
+      DropFromLargestBacklog ();
+    }
+}
+
+void
+RequestQueue::SetQueueTimeout (Time t)
+{
+  // Recompute every deadline so that entries with their own timeout stay within it
+  m_deadlines.clear ();
+  for (uint32_t i = m_oldest; i != NONE; i = m_records[i].newer)
+    {
+      QueueRecord & record = m_records[i];
+      record.expire = record.queued + std::min (record.timeout, t);
+      m_deadlines.insert (std::make_pair (record.expire, i));
+    }
+  m_queueTimeout = t;
+}
+
 void
 RequestQueue::DropPacketWithDst (Ipv4Address dst)
 {
   NS_LOG_FUNCTION (this << dst);
   Purge ();
-  for (std::vector<QueueEntry>::iterator i = m_queue.begin (); i
-       != m_queue.end (); ++i)
+  std::unordered_map<uint32_t, DestinationQueue>::const_iterator d = m_destinations.find (dst.Get ());
+  if (d == m_destinations.end ())
     {
-      if (IsEqual (*i, dst))
-        {
-          Drop (*i, "DropPacketWithDst ");
-        }
+      return;
+    }
+  uint32_t i = d->second.oldest;
+  while (i != NONE)
+    {
+      uint32_t next = m_records[i].newerToDst;
+      DropRecord (i, "DropPacketWithDst ");
+      i = next;
     }
-  m_queue.erase (std::remove_if (m_queue.begin (), m_queue.end (),
-                                 std::bind2nd (std::ptr_fun (RequestQueue::IsEqual), dst)), m_queue.end ());
 }
 
 bool
 RequestQueue::Dequeue (Ipv4Address dst, QueueEntry & entry)
 {
   Purge ();
-  for (std::vector<QueueEntry>::iterator i = m_queue.begin (); i != m_queue.end (); ++i)
+  std::unordered_map<uint32_t, DestinationQueue>::const_iterator d = m_destinations.find (dst.Get ());
+  if (d == m_destinations.end ())
     {
-      if (i->GetIpv4Header ().GetDestination () == dst)
-        {
-          entry = *i;
-          m_queue.erase (i);
-          return true;
-        }
+      return false;
     }
-  return false;
+  uint32_t i = d->second.oldest;
+  GetEntry (i, entry);
+  Unlink (i);
+  return true;
+}
+
+uint32_t
+RequestQueue::DequeueAll (Ipv4Address dst, std::vector<QueueEntry> & entries)
+{
+  Purge ();
+  std::unordered_map<uint32_t, DestinationQueue>::const_iterator d = m_destinations.find (dst.Get ());
+  if (d == m_destinations.end ())
+    {
+      return 0;
+    }
+  uint32_t n = 0;
+  uint32_t i = d->second.oldest;
+  while (i != NONE)
+    {
+      uint32_t next = m_records[i].newerToDst;
+      entries.push_back (QueueEntry ());
+      GetEntry (i, entries.back ());
+      Unlink (i);
+      i = next;
+      ++n;
+    }
+  return n;
 }
 
 bool
 RequestQueue::Find (Ipv4Address dst)
 {
-  for (std::vector<QueueEntry>::const_iterator i = m_queue.begin (); i
-       != m_queue.end (); ++i)
+  return m_destinations.find (dst.Get ()) != m_destinations.end ();
+}
+
+void
+RequestQueue::Purge ()
+{
+  Time now = Simulator::Now ();
+  while (!m_deadlines.empty () && m_deadlines.begin ()->first < now)
+    {
+      DropRecord (m_deadlines.begin ()->second, "Drop outdated packet ");
+    }
+}
+
+bool
+RequestQueue::HasRoom (uint32_t bytes) const
+{
+  return m_records.size () - m_freeRecords.size () < m_maxLen
+         && (m_maxBytes == 0 || m_bytes + bytes <= m_maxBytes);
+}
+
+void
+RequestQueue::DropFromLargestBacklog ()
+{
+  NS_ASSERT (!m_backlogs.empty ());
+  uint32_t oldest = m_destinations[m_backlogs.rbegin ()->second].oldest;
+  DropRecord (oldest, "Drop the most aged packet of the largest backlog ");
+}
+
+void
+RequestQueue::Link (QueueEntry const & entry, Time timeout)
+{
+  uint32_t index;
+  if (m_freeRecords.empty ())
+    {
+      index = m_records.size ();
+      m_records.push_back (QueueRecord ());
+    }
+  else
     {
-      if (i->GetIpv4Header ().GetDestination () == dst)
+      index = m_freeRecords.back ();
+      m_freeRecords.pop_back ();
+    }
+  QueueRecord & record = m_records[index];
+  record.packet = entry.GetPacket ();
+  record.header = entry.GetIpv4Header ();
+  record.queued = Simulator::Now ();
+  record.timeout = timeout;
+  record.expire = record.queued + entry.GetExpireTime ();
+  record.callbacks = InternCallbacks (entry.GetUnicastForwardCallback (), entry.GetErrorCallback ());
+  m_deadlines.insert (std::make_pair (record.expire, index));
+  m_keys.insert (GetKey (record.packet, record.header));
+  record.older = m_newest;
+  record.newer = NONE;
+  if (m_newest != NONE)
+    {
+      m_records[m_newest].newer = index;
+    }
+  else
+    {
+      m_oldest = index;
+    }
+  m_newest = index;
+
+  uint32_t dst = record.header.GetDestination ().Get ();
+  uint32_t bytes = record.packet->GetSize ();
+  DestinationQueue empty = { NONE, NONE, 0, 0 };
+  DestinationQueue & d = m_destinations.insert (std::make_pair (dst, empty)).first->second;
+  m_backlogs.erase (std::make_pair (d.bytes, dst));
+  d.bytes += bytes;
+  m_backlogs.insert (std::make_pair (d.bytes, dst));
+  m_bytes += bytes;
+  record.olderToDst = d.newest;
+  record.newerToDst = NONE;
+  if (d.newest != NONE)
+    {
+      m_records[d.newest].newerToDst = index;
+    }
+  else
+    {
+      d.oldest = index;
+    }
+  d.newest = index;
+  ++d.size;
+}
+
+void
+RequestQueue::Unlink (uint32_t index)
+{
+  QueueRecord & record = m_records[index];
+  if (record.older != NONE)
+    {
+      m_records[record.older].newer = record.newer;
+    }
+  else
+    {
+      m_oldest = record.newer;
+    }
+  if (record.newer != NONE)
+    {
+      m_records[record.newer].older = record.older;
+    }
+  else
+    {
+      m_newest = record.older;
+    }
+
+  uint32_t dst = record.header.GetDestination ().Get ();
+  uint32_t bytes = record.packet->GetSize ();
+  std::unordered_map<uint32_t, DestinationQueue>::iterator d = m_destinations.find (dst);
+  NS_ASSERT (d != m_destinations.end ());
+  m_backlogs.erase (std::make_pair (d->second.bytes, dst));
+  d->second.bytes -= bytes;
+  m_bytes -= bytes;
+  if (--d->second.size == 0)
+    {
+      m_destinations.erase (d);
+    }
+  else
+    {
+      m_backlogs.insert (std::make_pair (d->second.bytes, dst));
+      if (record.olderToDst != NONE)
+        {
+          m_records[record.olderToDst].newerToDst = record.newerToDst;
+        }
+      else
         {
-          return true;
+          d->second.oldest = record.newerToDst;
+        }
+      if (record.newerToDst != NONE)
+        {
+          m_records[record.newerToDst].olderToDst = record.olderToDst;
+        }
+      else
+        {
+          d->second.newest = record.olderToDst;
         }
     }
-  return false;
+  m_keys.erase (GetKey (record.packet, record.header));
+  m_deadlines.erase (std::make_pair (record.expire, index));
+  // Release the packet and callbacks now rather than on reuse
+  record.packet = 0;
+  ReleaseCallbacks (record.callbacks);
+  m_freeRecords.push_back (index);
 }
 
-/**
- * \brief IsExpired structure
- */
-struct IsExpired
-{
-  bool
-  /**
-   * Check if the entry is expired
-   *
-   * \param e QueueEntry entry
-   * \return true if expired, false otherwise
-   */
-  operator() (QueueEntry const & e) const
-  {
-    return (e.GetExpireTime () < Seconds (0));
-  }
-};
-
 void
-RequestQueue::Purge ()
+RequestQueue::GetEntry (uint32_t index, QueueEntry & entry) const
+{
+  QueueRecord const & record = m_records[index];
+  SharedCallbacks const & callbacks = m_callbacks[record.callbacks];
+  entry.SetPacket (record.packet);
+  entry.SetIpv4Header (record.header);
+  entry.SetUnicastForwardCallback (callbacks.ucb);
+  entry.SetErrorCallback (callbacks.ecb);
+  entry.SetExpireTime (record.expire - Simulator::Now ());
+}
+
+uint32_t
+RequestQueue::InternCallbacks (UnicastForwardCallback const & ucb, ErrorCallback const & ecb)
 {
-  IsExpired pred;
-  for (std::vector<QueueEntry>::iterator i = m_queue.begin (); i
-       != m_queue.end (); ++i)
+  // There are only as many distinct callbacks as input interfaces and local senders
+  uint32_t unused = m_callbacks.size ();
+  for (uint32_t i = 0; i < m_callbacks.size (); ++i)
     {
-      if (pred (*i))
+      SharedCallbacks & callbacks = m_callbacks[i];
+      if (callbacks.users == 0)
+        {
+          unused = i;
+        }
+      else if (SameCallback (callbacks.ucb, ucb) && SameCallback (callbacks.ecb, ecb))
         {
-          Drop (*i, "Drop outdated packet ");
+          ++callbacks.users;
+          return i;
         }
     }
-  m_queue.erase (std::remove_if (m_queue.begin (), m_queue.end (), pred),
-                 m_queue.end ());
+  if (unused == m_callbacks.size ())
+    {
+      m_callbacks.push_back (SharedCallbacks ());
+    }
+  SharedCallbacks & callbacks = m_callbacks[unused];
+  callbacks.ucb = ucb;
+  callbacks.ecb = ecb;
+  callbacks.users = 1;
+  return unused;
+}
+
+void
+RequestQueue::ReleaseCallbacks (uint32_t index)
+{
+  SharedCallbacks & callbacks = m_callbacks[index];
+  if (--callbacks.users == 0)
+    {
+      callbacks.ucb = UnicastForwardCallback ();
+      callbacks.ecb = ErrorCallback ();
+    }
 }
 
 void
-RequestQueue::Drop (QueueEntry en, std::string reason)
+RequestQueue::DropRecord (uint32_t index, std::string const & reason)
+{
+  QueueRecord const & record = m_records[index];
+  NS_LOG_LOGIC (reason << record.packet->GetUid () << " " << record.header.GetDestination ());
+  m_callbacks[record.callbacks].ecb (record.packet, record.header, Socket::ERROR_NOROUTETOHOST);
+  Unlink (index);
+}
+
+void
+RequestQueue::Drop (QueueEntry const & en, std::string const & reason)
 {
   NS_LOG_LOGIC (reason << en.GetPacket ()->GetUid () << " " << en.GetIpv4Header ().GetDestination ());
   en.GetErrorCallback () (en.GetPacket (), en.GetIpv4Header (),
                           Socket::ERROR_NOROUTETOHOST);
-  return;
+}
+
+void
+RetransmitBuffer::Add (Ipv4Address nextHop, QueueEntry & entry)
+{
+  if (m_maxLen == 0)
+    {
+      return;
+    }
+  std::deque<QueueEntry> & entries = m_nextHops[nextHop.Get ()];
+  Purge (entries);
+  if (entries.size () >= m_maxLen)
+    {
+      NS_LOG_LOGIC ("Forget packet " << entries.front ().GetPacket ()->GetUid () << " sent to " << nextHop);
+      entries.pop_front ();
+    }
+  entry.SetExpireTime (m_timeout);
+  entries.push_back (entry);
+}
+
+bool
+RetransmitBuffer::Remove (Ipv4Address nextHop, QueueEntry & entry)
+{
+  std::unordered_map<uint32_t, std::deque<QueueEntry> >::iterator i = m_nextHops.find (nextHop.Get ());
+  if (i == m_nextHops.end ())
+    {
+      return false;
+    }
+  Purge (i->second);
+  bool found = !i->second.empty ();
+  if (found)
+    {
+      entry = i->second.front ();
+      i->second.pop_front ();
+    }
+  if (i->second.empty ())
+    {
+      m_nextHops.erase (i);
+    }
+  return found;
+}
+
+uint32_t
+RetransmitBuffer::RemoveAll (Ipv4Address nextHop, std::vector<QueueEntry> & entries)
+{
+  std::unordered_map<uint32_t, std::deque<QueueEntry> >::iterator i = m_nextHops.find (nextHop.Get ());
+  if (i == m_nextHops.end ())
+    {
+      return 0;
+    }
+  Purge (i->second);
+  uint32_t n = i->second.size ();
+  entries.insert (entries.end (), i->second.begin (), i->second.end ());
+  m_nextHops.erase (i);
+  return n;
+}
+
+uint32_t
+RetransmitBuffer::GetSize ()
+{
+  uint32_t n = 0;
+  for (std::unordered_map<uint32_t, std::deque<QueueEntry> >::iterator i = m_nextHops.begin ();
+       i != m_nextHops.end (); )
+    {
+      Purge (i->second);
+      if (i->second.empty ())
+        {
+          i = m_nextHops.erase (i);
+        }
+      else
+        {
+          n += i->second.size ();
+          ++i;
+        }
+    }
+  return n;
+}
+
+void
+RetransmitBuffer::Purge (std::deque<QueueEntry> & entries)
+{
+  // The oldest packets expire first unless the timeout was lowered, which only delays forgetting the newer ones
+  while (!entries.empty () && entries.front ().GetExpireTime () < Seconds (0))
+    {
+      entries.pop_front ();
+    }
 }
 
 }  // namespace aodv
@@ -29,6 +29,10 @@
 #define ARA_RQUEUE_H
 
 #include <vector>
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/simulator.h"
 
@@ -82,7 +86,7 @@ public:
    * Get unicast forward callback
    * \returns unicast callback
    */
-  UnicastForwardCallback GetUnicastForwardCallback () const
+  UnicastForwardCallback const & GetUnicastForwardCallback () const
   {
     return m_ucb;
   }
@@ -98,7 +102,7 @@ public:
    * Get error callback
    * \returns the error callback
    */
-  ErrorCallback GetErrorCallback () const
+  ErrorCallback const & GetErrorCallback () const
   {
     return m_ecb;
   }
@@ -130,7 +134,7 @@ public:
    * Get IPv4 header
    * \returns the IPv4 header
    */
-  Ipv4Header GetIpv4Header () const
+  Ipv4Header const & GetIpv4Header () const
   {
     return m_header;
   }
@@ -176,6 +180,9 @@ private:
  * \brief AODV route request queue
  *
  * Since AODV is an on demand routing we queue requests while looking for route.
+ * The queue is bounded in packets and bytes.  When it overflows, the most aged
+ * packet of the destination with the largest backlog in bytes is dropped, so
+ * that one unreachable destination cannot take the whole queue.
  */
 class RequestQueue
 {
@@ -185,11 +192,19 @@ public:
    *
    * \param maxLen the maximum length
    * \param routeToQueueTimeout the route to queue timeout
+   * \param maxBytes the maximum number of bytes, 0 for no limit
+   * \param maxLenPerDst the maximum length per destination, 0 for no limit
    */
-  RequestQueue (uint32_t maxLen, Time routeToQueueTimeout)
-    : m_maxLen (maxLen),
-      m_queueTimeout (routeToQueueTimeout)
+  RequestQueue (uint32_t maxLen, Time routeToQueueTimeout, uint32_t maxBytes = 0, uint32_t maxLenPerDst = 0)
+    : m_oldest (NONE),
+      m_newest (NONE),
+      m_bytes (0),
+      m_maxLen (maxLen),
+      m_queueTimeout (routeToQueueTimeout),
+      m_maxBytes (maxBytes),
+      m_maxLenPerDst (maxLenPerDst)
   {
+    m_records.reserve (maxLen);
   }
   /**
    * Push entry in queue, if there is no entry with the same packet and destination address in queue.
@@ -197,6 +212,14 @@ public:
    * \returns true if the entry is queued
    */
   bool Enqueue (QueueEntry & entry);
+  /**
+   * Push entry in queue with its own timeout, if there is no entry with the same packet and destination address in queue.
+   * The timeout is capped by the queue timeout, also when that changes later.
+   * \param entry the queue entry
+   * \param timeout the time the entry may be queued for
+   * \returns true if the entry is queued
+   */
+  bool Enqueue (QueueEntry & entry, Time timeout);
   /**
    * Return first found (the earliest) entry for given destination
    * 
@@ -205,6 +228,14 @@ public:
    * \returns true if the entry is dequeued
    */
   bool Dequeue (Ipv4Address dst, QueueEntry & entry);
+  /**
+   * Remove all entries for given destination, the earliest first
+   *
+   * \param dst the destination IP address
+   * \param entries the vector to append the entries to
+   * \returns the number of entries dequeued
+   */
+  uint32_t DequeueAll (Ipv4Address dst, std::vector<QueueEntry> & entries);
   /**
    * Remove all packets with destination IP address dst
    * \param dst the destination IP address
@@ -221,6 +252,28 @@ public:
    * \returns the number of entries
    */
   uint32_t GetSize ();
+  /**
+   * \returns the number of bytes of the queued packets
+   */
+  uint32_t GetBytes ();
+  /**
+   * \returns the number of pooled entries, in use and free
+   */
+  uint32_t GetPoolSize () const
+  {
+    return m_records.size ();
+  }
+  /**
+   * \returns the number of shared callback slots, in use and unused
+   */
+  uint32_t GetCallbackSlots () const
+  {
+    return m_callbacks.size ();
+  }
+  /**
+   * \returns the number of shared callback slots used by queued packets
+   */
+  uint32_t GetCallbackSlotsInUse () const;
 
   // Fields
   /**
@@ -232,12 +285,39 @@ public:
     return m_maxLen;
   }
   /**
-   * Set maximum queue length
+   * Set maximum queue length, dropping packets if the queue is longer
    * \param len The maximum queue length
    */
-  void SetMaxQueueLen (uint32_t len)
+  void SetMaxQueueLen (uint32_t len);
+  /**
+   * Get maximum number of queued bytes
+   * \returns the maximum number of bytes, 0 for no limit
+   */
+  uint32_t GetMaxQueueBytes () const
   {
-    m_maxLen = len;
+    return m_maxBytes;
+  }
+  /**
+   * Set maximum number of queued bytes, dropping packets if the queue is larger
+   * \param bytes The maximum number of bytes, 0 for no limit
+   */
+  void SetMaxQueueBytes (uint32_t bytes);
+  /**
+   * Get maximum queue length per destination
+   * \returns the maximum queue length per destination, 0 for no limit
+   */
+  uint32_t GetMaxQueueLenPerDestination () const
+  {
+    return m_maxLenPerDst;
+  }
+  /**
+   * Set maximum queue length per destination.  Destinations above the new
+   * length keep their packets until they are dequeued or expire.
+   * \param len The maximum queue length per destination, 0 for no limit
+   */
+  void SetMaxQueueLenPerDestination (uint32_t len)
+  {
+    m_maxLenPerDst = len;
   }
   /**
    * Get queue timeout
@@ -248,41 +328,248 @@ public:
     return m_queueTimeout;
   }
   /**
-   * Set queue timeout
+   * Set queue timeout, also for the queued packets.  Packets queued with
+   * their own timeout are still held no longer than it.
    * \param t The queue timeout
    */
-  void SetQueueTimeout (Time t)
-  {
-    m_queueTimeout = t;
-  }
+  void SetQueueTimeout (Time t);
 
 private:
-  /// The queue
-  std::vector<QueueEntry> m_queue;
-  /// Remove all expired entries
+  /// IPv4 routing unicast forward callback typedef
+  typedef QueueEntry::UnicastForwardCallback UnicastForwardCallback;
+  /// IPv4 routing error callback typedef
+  typedef QueueEntry::ErrorCallback ErrorCallback;
+  /// Index of no entry
+  static const uint32_t NONE = 0xffffffff;
+  /**
+   * Queued packet linked into the age order and the order of its destination.
+   * The callbacks are shared by all packets that were queued with them.
+   */
+  struct QueueRecord
+  {
+    Ptr<const Packet> packet; ///< the data packet
+    Ipv4Header header; ///< the IP header
+    Time expire; ///< the expiration time
+    Time queued; ///< the time the entry was queued
+    Time timeout; ///< the timeout of the entry, Time::Max () for the queue timeout
+    uint32_t callbacks; ///< index of the shared callbacks
+    uint32_t older; ///< next older entry
+    uint32_t newer; ///< next newer entry
+    uint32_t olderToDst; ///< next older entry for the same destination
+    uint32_t newerToDst; ///< next newer entry for the same destination
+  };
+  /// Callbacks shared by queued packets
+  struct SharedCallbacks
+  {
+    UnicastForwardCallback ucb; ///< unicast forward callback
+    ErrorCallback ecb; ///< error callback
+    uint32_t users; ///< number of queued packets using the callbacks
+  };
+  /// Entries queued for one destination
+  struct DestinationQueue
+  {
+    uint32_t oldest; ///< oldest entry
+    uint32_t newest; ///< newest entry
+    uint32_t size; ///< number of entries
+    uint32_t bytes; ///< number of bytes
+  };
+  /**
+   * Entries in use and on the free list.  The capacity is reserved for the
+   * maximum queue length, so that the array is never reallocated.
+   */
+  std::vector<QueueRecord> m_records;
+  /// Free entries
+  std::vector<uint32_t> m_freeRecords;
+  /// Oldest entry
+  uint32_t m_oldest;
+  /// Newest entry
+  uint32_t m_newest;
+  /// Entries of each destination, keyed by destination address
+  std::unordered_map<uint32_t, DestinationQueue> m_destinations;
+  /// Destinations ordered by number of queued bytes, as (bytes, destination address)
+  std::set<std::pair<uint32_t, uint32_t> > m_backlogs;
+  /// Number of bytes of the queued packets
+  uint32_t m_bytes;
+  /// Callbacks of the queued packets, in use and unused
+  std::vector<SharedCallbacks> m_callbacks;
+  /// Keys of the queued entries, to reject duplicates
+  std::unordered_set<uint64_t> m_keys;
+  /**
+   * Expiration times and indices of the entries.  Entries may be queued for
+   * different times, so this order differs from the age order.
+   */
+  std::set<std::pair<Time, uint32_t> > m_deadlines;
+  /**
+   * \param packet the packet
+   * \param header the IP header
+   * \returns the key of the packet UID and destination address
+   */
+  static uint64_t GetKey (Ptr<const Packet> const & packet, Ipv4Header const & header)
+  {
+    return (uint64_t (packet->GetUid ()) << 32) | header.GetDestination ().Get ();
+  }
+  /// Remove all expired entries, the earliest deadlines first
   void Purge ();
+  /**
+   * Check whether a packet fits in the queue
+   * \param bytes the packet size
+   * \returns true if there is room for one more packet of that size
+   */
+  bool HasRoom (uint32_t bytes) const;
+  /// Drop the most aged entry of the destination with the largest backlog
+  void DropFromLargestBacklog ();
+  /**
+   * Link a new entry as the newest in the age order and for its destination
+   * \param entry the queue entry
+   * \param timeout the timeout of the entry, Time::Max () for the queue timeout
+   */
+  void Link (QueueEntry const & entry, Time timeout);
+  /**
+   * Unlink an entry and put it on the free list
+   * \param index the entry index
+   */
+  void Unlink (uint32_t index);
+  /**
+   * Copy a queued packet into a queue entry
+   * \param index the entry index
+   * \param entry the queue entry
+   */
+  void GetEntry (uint32_t index, QueueEntry & entry) const;
+  /**
+   * Share callbacks with the queued packets that use the same ones
+   * \param ucb the unicast forward callback
+   * \param ecb the error callback
+   * \returns the index of the shared callbacks
+   */
+  uint32_t InternCallbacks (UnicastForwardCallback const & ucb, ErrorCallback const & ecb);
+  /**
+   * Release shared callbacks of a packet that leaves the queue
+   * \param index the index of the shared callbacks
+   */
+  void ReleaseCallbacks (uint32_t index);
+  /**
+   * Drop a queued packet and unlink its entry
+   * \param index the entry index
+   * \param reason the reason to drop the entry
+   */
+  void DropRecord (uint32_t index, std::string const & reason);
   /**
    * Notify that packet is dropped from queue by timeout
    * \param en the queue entry to drop
    * \param reason the reason to drop the entry
    */
-  void Drop (QueueEntry en, std::string reason);
+  void Drop (QueueEntry const & en, std::string const & reason);
   /// The maximum number of packets that we allow a routing protocol to buffer.
   uint32_t m_maxLen;
   /// The maximum period of time that a routing protocol is allowed to buffer a packet for, seconds.
   Time m_queueTimeout;
+  /// The maximum number of bytes that we allow a routing protocol to buffer, 0 for no limit.
+  uint32_t m_maxBytes;
+  /// The maximum number of packets buffered per destination, 0 for no limit.
+  uint32_t m_maxLenPerDst;
+};
+
+
+/**
+ * \ingroup ara
+ * \brief Packets recently handed to the MAC, per next hop
+ *
+ * A forwarded packet is remembered for a short time after it is sent to its
+ * next hop, so that it can be routed again if the MAC drops it or the link
+ * to the next hop breaks before it leaves the node.  Packets leave the
+ * buffer when their frame is reported delivered, when they are taken to be
+ * routed again, or silently when the timeout expires: the frame is then
+ * assumed to have been sent.
+ */
+class RetransmitBuffer
+{
+public:
   /**
-   * Determine if queue matches a destination address
-   * \param en The queue entry
-   * \param dst The destination IPv4 address
-   * \returns true if the queue entry matches the destination address
+   * constructor
+   *
+   * \param maxLen the maximum number of packets per next hop, 0 disables the buffer
+   * \param timeout the time a packet is remembered for
    */
-  static bool IsEqual (QueueEntry en, const Ipv4Address dst)
+  RetransmitBuffer (uint32_t maxLen, Time timeout)
+    : m_maxLen (maxLen),
+      m_timeout (timeout)
   {
-    return (en.GetIpv4Header ().GetDestination () == dst);
   }
-};
+  /**
+   * Remember a packet sent to a next hop, forgetting the oldest packet of
+   * the next hop if it has too many
+   * \param nextHop the next hop
+   * \param entry the packet, its IP header and callbacks
+   */
+  void Add (Ipv4Address nextHop, QueueEntry & entry);
+  /**
+   * Take the oldest packet sent to a next hop
+   * \param nextHop the next hop
+   * \param entry the queue entry
+   * \returns true if the next hop has a packet
+   */
+  bool Remove (Ipv4Address nextHop, QueueEntry & entry);
+  /**
+   * Take all packets sent to a next hop, the oldest first
+   * \param nextHop the next hop
+   * \param entries the vector to append the entries to
+   * \returns the number of entries taken
+   */
+  uint32_t RemoveAll (Ipv4Address nextHop, std::vector<QueueEntry> & entries);
+  /// Forget all packets
+  void Clear ()
+  {
+    m_nextHops.clear ();
+  }
+  /**
+   * \returns the number of packets remembered
+   */
+  uint32_t GetSize ();
+  /**
+   * \returns the maximum number of packets per next hop
+   */
+  uint32_t GetMaxLen () const
+  {
+    return m_maxLen;
+  }
+  /**
+   * Set the maximum number of packets per next hop.  Next hops above the
+   * new length keep their packets until they are taken or expire.
+   * \param len the maximum number of packets per next hop, 0 disables the buffer
+   */
+  void SetMaxLen (uint32_t len)
+  {
+    m_maxLen = len;
+  }
+  /**
+   * \returns the time a packet is remembered for
+   */
+  Time GetTimeout () const
+  {
+    return m_timeout;
+  }
+  /**
+   * Set the time a packet is remembered for, from the next packet added
+   * \param t the timeout
+   */
+  void SetTimeout (Time t)
+  {
+    m_timeout = t;
+  }
 
+private:
+  /**
+   * Forget the expired packets of a next hop, the oldest first
+   * \param entries the packets of the next hop
+   */
+  static void Purge (std::deque<QueueEntry> & entries);
+  /// Packets of each next hop, the oldest first, keyed by next hop address
+  std::unordered_map<uint32_t, std::deque<QueueEntry> > m_nextHops;
+  /// The maximum number of packets per next hop
+  uint32_t m_maxLen;
+  /// The time a packet is remembered for
+  Time m_timeout;
+};
 
 }  // namespace aodv
 }  // namespace ns3
@@ -43,14 +43,18 @@ namespace ara {
  */
 
 RoutingTableEntry::RoutingTableEntry (Ptr<NetDevice> dev, Ipv4Address dst, bool vSeqNo, uint32_t seqNo,
-                                      Ipv4InterfaceAddress iface, uint16_t pheromone, Ipv4Address nextHop, Time lifetime)
+                                      Ipv4InterfaceAddress iface, uint16_t hops, Ipv4Address nextHop, Time lifetime)
   : m_ackTimer (Timer::CANCEL_ON_DESTROY),
     m_validSeqNo (vSeqNo),
     m_seqNo (seqNo),
-    m_pheromone (pheromone),
+    m_hops (hops),
     m_lifeTime (lifetime + Simulator::Now ()),
+    m_indexedExpiry (Time::Max ()),
+    m_nodeId (NodeIdMap::NONE),
     m_iface (iface),
     m_flag (VALID),
+    m_decay (DECAY_NONE),
+    m_evaporationRate (0),
     m_reqCount (0),
     m_blackListState (false),
     m_blackListTimeout (Simulator::Now ())
@@ -60,6 +64,10 @@ RoutingTableEntry::RoutingTableEntry (Ptr<NetDevice> dev, Ipv4Address dst, bool
   m_ipv4Route->SetGateway (nextHop);
   m_ipv4Route->SetSource (m_iface.GetLocal ());
   m_ipv4Route->SetOutputDevice (dev);
+  if (nextHop != Ipv4Address ())
+    {
+      AddNextHop (nextHop, dev, iface, GetInitialPheromone (hops), lifetime);
+    }
 }
 
 RoutingTableEntry::~RoutingTableEntry ()
@@ -67,32 +75,365 @@ RoutingTableEntry::~RoutingTableEntry ()
 }
 
 bool
-RoutingTableEntry::InsertPrecursor (Ipv4Address id)
+RoutingTableEntry::AddNextHop (Ipv4Address nextHop, Ptr<NetDevice> dev, Ipv4InterfaceAddress iface,
+                               double pheromone, Time lifetime)
 {
-  NS_LOG_FUNCTION (this << id);
-  if (!LookupPrecursor (id))
+  NS_LOG_FUNCTION (this << nextHop << pheromone << lifetime.GetSeconds ());
+  Time expire = lifetime + Simulator::Now ();
+  for (std::vector<NextHop>::iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      if (i->m_nextHop == nextHop)
+        {
+          i->m_pheromone = pheromone;
+          i->m_lastUpdate = Simulator::Now ();
+          i->m_expire = std::max (expire, i->m_expire);
+          UpdateCumulativePheromone ();
+          NextHopOutput & output = m_nextHopOutputs[i - m_nextHops.begin ()];
+          if (output.m_iface != iface || output.m_route->GetOutputDevice () != dev)
+            {
+              output.m_iface = iface;
+              output.m_route = Create<Ipv4Route> ();
+              output.m_route->SetDestination (m_ipv4Route->GetDestination ());
+              output.m_route->SetGateway (nextHop);
+              output.m_route->SetSource (iface.GetLocal ());
+              output.m_route->SetOutputDevice (dev);
+            }
+          return false;
+        }
+    }
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (m_ipv4Route->GetDestination ());
+  route->SetGateway (nextHop);
+  route->SetSource (iface.GetLocal ());
+  route->SetOutputDevice (dev);
+  m_nextHops.push_back (NextHop (nextHop, pheromone, expire));
+  m_nextHopOutputs.push_back (NextHopOutput (iface, route));
+  UpdateCumulativePheromone ();
+  return true;
+}
+
+bool
+RoutingTableEntry::DeleteNextHop (Ipv4Address nextHop)
+{
+  NS_LOG_FUNCTION (this << nextHop);
+  for (uint32_t k = 0; k < m_nextHops.size (); ++k)
+    {
+      if (m_nextHops[k].m_nextHop == nextHop)
+        {
+          EraseNextHop (k);
+          UpdateCumulativePheromone ();
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+RoutingTableEntry::EraseNextHop (uint32_t k)
+{
+  m_nextHops.erase (m_nextHops.begin () + k);
+  m_nextHopOutputs.erase (m_nextHopOutputs.begin () + k);
+}
+
+bool
+RoutingTableEntry::RefreshNextHop (Ipv4Address nextHop, Time lifetime)
+{
+  for (std::vector<NextHop>::iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      if (i->m_nextHop == nextHop)
+        {
+          i->m_expire = std::max (lifetime + Simulator::Now (), i->m_expire);
+          return true;
+        }
+    }
+  return false;
+}
+
+double
+RoutingTableEntry::GetNextHopPheromone (Ipv4Address nextHop) const
+{
+  for (std::vector<NextHop>::const_iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      if (i->m_nextHop == nextHop)
+        {
+          return Weigh (*i, Simulator::Now ());
+        }
+    }
+  return 0;
+}
+
+bool
+RoutingTableEntry::SetNextHopLinkQuality (Ipv4Address nextHop, double quality)
+{
+  for (std::vector<NextHop>::iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      if (i->m_nextHop == nextHop)
+        {
+          if (i->m_linkQuality != quality)
+            {
+              i->m_linkQuality = quality;
+              UpdateCumulativePheromone ();
+            }
+          return true;
+        }
+    }
+  return false;
+}
+
+bool
+RoutingTableEntry::ReinforceNextHop (Ipv4Address nextHop, double deposit, Time interval)
+{
+  Time now = Simulator::Now ();
+  for (std::vector<NextHop>::iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      if (i->m_nextHop == nextHop)
+        {
+          if (now < i->m_lastReinforcement + interval)
+            {
+              return false;
+            }
+          i->m_pheromone = Evaporate (*i, now) + deposit;
+          i->m_lastUpdate = now;
+          i->m_lastReinforcement = now;
+          UpdateCumulativePheromone ();
+          return true;
+        }
+    }
+  return false;
+}
+
+bool
+RoutingTableEntry::HasNextHop (Ipv4Address nextHop) const
+{
+  if (GetNextHop () == nextHop)
     {
-      m_precursorList.push_back (id);
       return true;
     }
-  else
+  for (std::vector<NextHop>::const_iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      if (i->m_nextHop == nextHop)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+RoutingTableEntry::SetEvaporation (PheromoneDecay decay, double rate)
+{
+  if (decay == m_decay && rate == m_evaporationRate)
+    {
+      return;
+    }
+  // Bring the stored values up to date under the old curve before switching
+  Time now = Simulator::Now ();
+  for (std::vector<NextHop>::iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      i->m_pheromone = Evaporate (*i, now);
+      i->m_lastUpdate = now;
+    }
+  m_decay = decay;
+  m_evaporationRate = rate;
+  UpdateCumulativePheromone ();
+}
+
+double
+RoutingTableEntry::Evaporate (NextHop const & nextHop, Time now) const
+{
+  double elapsed = (now - nextHop.m_lastUpdate).GetSeconds ();
+  switch (m_decay)
+    {
+    case DECAY_EXPONENTIAL:
+      {
+        // A fraction above 1 evaporates everything at once
+        return nextHop.m_pheromone * std::pow (1 - std::min (m_evaporationRate, 1.0), elapsed);
+      }
+    case DECAY_LINEAR:
+      {
+        return std::max (0.0, nextHop.m_pheromone - m_evaporationRate * elapsed);
+      }
+    default:
+      {
+        return nextHop.m_pheromone;
+      }
+    }
+}
+
+bool
+RoutingTableEntry::PurgeNextHops ()
+{
+  if (m_nextHops.empty ())
+    {
+      return false;
+    }
+  Time now = Simulator::Now ();
+  uint32_t size = m_nextHops.size ();
+  bool currentLost = false;
+  for (uint32_t k = 0; k < m_nextHops.size (); )
+    {
+      if (m_nextHops[k].m_expire < now)
+        {
+          NS_LOG_LOGIC ("Next hop " << m_nextHops[k].m_nextHop << " to " << GetDestination () << " expired");
+          currentLost = currentLost || (m_nextHops[k].m_nextHop == GetNextHop ());
+          EraseNextHop (k);
+        }
+      else
+        {
+          ++k;
+        }
+    }
+  if (m_nextHops.size () == size)
     {
       return false;
     }
+  UpdateCumulativePheromone ();
+  if (currentLost)
+    {
+      SelectBestNextHop ();
+    }
+  return true;
 }
 
 bool
-RoutingTableEntry::LookupPrecursor (Ipv4Address id)
+RoutingTableEntry::DeleteNextHopsFromInterface (Ipv4InterfaceAddress iface)
 {
-  NS_LOG_FUNCTION (this << id);
-  for (std::vector<Ipv4Address>::const_iterator i = m_precursorList.begin (); i
-       != m_precursorList.end (); ++i)
+  uint32_t size = m_nextHops.size ();
+  bool currentLost = false;
+  for (uint32_t k = 0; k < m_nextHops.size (); )
     {
-      if (*i == id)
+      if (m_nextHopOutputs[k].m_iface == iface)
         {
-          NS_LOG_LOGIC ("Precursor " << id << " found");
-          return true;
+          currentLost = currentLost || (m_nextHops[k].m_nextHop == GetNextHop ());
+          EraseNextHop (k);
+        }
+      else
+        {
+          ++k;
+        }
+    }
+  if (m_nextHops.size () == size)
+    {
+      return false;
+    }
+  UpdateCumulativePheromone ();
+  if (currentLost)
+    {
+      SelectBestNextHop ();
+    }
+  return true;
+}
+
+bool
+RoutingTableEntry::SelectBestNextHop ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_nextHops.empty ())
+    {
+      return false;
+    }
+  Time now = Simulator::Now ();
+  std::vector<NextHop>::const_iterator best = m_nextHops.begin ();
+  double bestPheromone = Weigh (*best, now);
+  for (std::vector<NextHop>::const_iterator i = m_nextHops.begin () + 1; i != m_nextHops.end (); ++i)
+    {
+      double pheromone = Weigh (*i, now);
+      if (pheromone > bestPheromone)
+        {
+          best = i;
+          bestPheromone = pheromone;
+        }
+    }
+  if (best->m_nextHop == GetNextHop ())
+    {
+      return true;
+    }
+  NS_LOG_LOGIC ("Switch next hop to " << GetDestination () << " from " << GetNextHop () << " to " << best->m_nextHop);
+  // The current route object may be shared with copies of this entry, so do not modify it in place
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (m_ipv4Route->GetDestination ());
+  NextHopOutput const & output = m_nextHopOutputs[best - m_nextHops.begin ()];
+  route->SetGateway (best->m_nextHop);
+  route->SetSource (output.m_iface.GetLocal ());
+  route->SetOutputDevice (output.m_route->GetOutputDevice ());
+  m_ipv4Route = route;
+  m_iface = output.m_iface;
+  return true;
+}
+
+Ptr<Ipv4Route>
+RoutingTableEntry::SelectRoute (double u) const
+{
+  if (m_nextHops.empty () || m_cumulativePheromone.back () <= 0)
+    {
+      return m_ipv4Route;
+    }
+  if (m_nextHops.size () == 1)
+    {
+      return m_nextHopOutputs.front ().m_route;
+    }
+  if (m_decay == DECAY_LINEAR)
+    {
+      // Linear evaporation changes the ratios between next hops over time, so weigh them now
+      Time now = Simulator::Now ();
+      double sum = 0;
+      for (std::vector<NextHop>::const_iterator j = m_nextHops.begin (); j != m_nextHops.end (); ++j)
+        {
+          sum += Weigh (*j, now);
         }
+      double target = u * sum;
+      sum = 0;
+      for (std::vector<NextHop>::const_iterator j = m_nextHops.begin (); j != m_nextHops.end (); ++j)
+        {
+          sum += Weigh (*j, now);
+          if (target < sum)
+            {
+              return m_nextHopOutputs[j - m_nextHops.begin ()].m_route;
+            }
+        }
+      return m_nextHopOutputs.back ().m_route;
+    }
+  // Without evaporation or with exponential evaporation the ratios between next hops do not
+  // change over time, so the running sum stays valid until a pheromone value is set
+  std::vector<double>::const_iterator i =
+    std::upper_bound (m_cumulativePheromone.begin (), m_cumulativePheromone.end (),
+                      u * m_cumulativePheromone.back ());
+  if (i == m_cumulativePheromone.end ())
+    {
+      --i;
+    }
+  return m_nextHopOutputs[i - m_cumulativePheromone.begin ()].m_route;
+}
+
+void
+RoutingTableEntry::UpdateCumulativePheromone ()
+{
+  m_cumulativePheromone.resize (m_nextHops.size ());
+  Time now = Simulator::Now ();
+  double sum = 0;
+  for (uint32_t i = 0; i < m_nextHops.size (); ++i)
+    {
+      sum += Weigh (m_nextHops[i], now);
+      m_cumulativePheromone[i] = sum;
+    }
+}
+
+bool
+RoutingTableEntry::InsertPrecursor (Ipv4Address id)
+{
+  NS_LOG_FUNCTION (this << id);
+  return m_precursors.Insert (NodeIdMap::Intern (id));
+}
+
+bool
+RoutingTableEntry::LookupPrecursor (Ipv4Address id)
+{
+  NS_LOG_FUNCTION (this << id);
+  NodeId nodeId = NodeIdMap::Lookup (id);
+  if (nodeId != NodeIdMap::NONE && m_precursors.Contains (nodeId))
+    {
+      NS_LOG_LOGIC ("Precursor " << id << " found");
+      return true;
     }
   NS_LOG_LOGIC ("Precursor " << id << " not found");
   return false;
@@ -102,18 +443,13 @@ bool
 RoutingTableEntry::DeletePrecursor (Ipv4Address id)
 {
   NS_LOG_FUNCTION (this << id);
-  std::vector<Ipv4Address>::iterator i = std::remove (m_precursorList.begin (),
-                                                      m_precursorList.end (), id);
-  if (i == m_precursorList.end ())
+  NodeId nodeId = NodeIdMap::Lookup (id);
+  if (nodeId == NodeIdMap::NONE || !m_precursors.Erase (nodeId))
     {
       NS_LOG_LOGIC ("Precursor " << id << " not found");
       return false;
     }
-  else
-    {
-      NS_LOG_LOGIC ("Precursor " << id << " found");
-      m_precursorList.erase (i, m_precursorList.end ());
-    }
+  NS_LOG_LOGIC ("Precursor " << id << " found");
   return true;
 }
 
@@ -121,13 +457,20 @@ void
 RoutingTableEntry::DeleteAllPrecursors ()
 {
   NS_LOG_FUNCTION (this);
-  m_precursorList.clear ();
+  m_precursors.Clear ();
 }
 
 bool
 RoutingTableEntry::IsPrecursorListEmpty () const
 {
-  return m_precursorList.empty ();
+  return m_precursors.IsEmpty ();
+}
+
+void
+RoutingTableEntry::GetPrecursors (NodeIdSet & prec) const
+{
+  NS_LOG_FUNCTION (this);
+  prec.Union (m_precursors);
 }
 
 void
@@ -138,23 +481,17 @@ RoutingTableEntry::GetPrecursors (std::vector<Ipv4Address> & prec) const
     {
       return;
     }
-  for (std::vector<Ipv4Address>::const_iterator i = m_precursorList.begin (); i
-       != m_precursorList.end (); ++i)
+  // Precursors are interned, so an address without an ID is not one of them
+  NodeIdSet added (m_precursors);
+  for (std::vector<Ipv4Address>::const_iterator i = prec.begin (); i != prec.end (); ++i)
     {
-      bool result = true;
-      for (std::vector<Ipv4Address>::const_iterator j = prec.begin (); j
-           != prec.end (); ++j)
+      NodeId id = NodeIdMap::Lookup (*i);
+      if (id != NodeIdMap::NONE)
         {
-          if (*j == *i)
-            {
-              result = false;
-            }
-        }
-      if (result)
-        {
-          prec.push_back (*i);
+          added.Erase (id);
         }
     }
+  added.GetAddresses (prec);
 }
 
 void
@@ -198,37 +535,61 @@ RoutingTableEntry::Print (Ptr<OutputStreamWrapper> stream) const
   *os << std::setiosflags (std::ios::fixed) <<
   std::setiosflags (std::ios::left) << std::setprecision (2) <<
   std::setw (14) << (m_lifeTime - Simulator::Now ()).GetSeconds ();
-  *os << "\t" << m_pheromone << "\n";
+  *os << "\t" << m_hops << "\t";
+  for (std::vector<NextHop>::const_iterator i = m_nextHops.begin (); i != m_nextHops.end (); ++i)
+    {
+      *os << i->m_nextHop << "(" << Evaporate (*i, Simulator::Now ()) << ") ";
+    }
+  *os << "\n";
 }
 
 /*
  The Routing Table
  */
 
-RoutingTable::RoutingTable (Time t)
-  : m_badLinkLifetime (t)
+RoutingTable::RoutingTable (Time t, PheromoneDecay decay, double rate)
+  : m_badLinkLifetime (t),
+    m_idGeneration (NodeIdMap::GetGeneration ()),
+    m_decay (decay),
+    m_evaporationRate (rate),
+    m_deposit (0),
+    m_reinforcementInterval (Seconds (0))
+{
+}
+
+void
+RoutingTable::SetPheromoneDecay (PheromoneDecay decay)
+{
+  m_decay = decay;
+  ApplyEvaporation ();
+}
+
+void
+RoutingTable::SetEvaporationRate (double rate)
 {
+  m_evaporationRate = rate;
+  ApplyEvaporation ();
+}
+
+void
+RoutingTable::ApplyEvaporation ()
+{
+  for (std::map<Ipv4Address, RoutingTableEntry>::iterator i = m_ipv4AddressEntry.begin (); i != m_ipv4AddressEntry.end (); ++i)
+    {
+      i->second.SetEvaporation (m_decay, m_evaporationRate);
+    }
 }
 
 bool
 RoutingTable::LookupRoute (Ipv4Address id, RoutingTableEntry & rt)
 {
   NS_LOG_FUNCTION (this << id);
-  Purge ();
-  if (m_ipv4AddressEntry.empty ())
+  RoutingTableEntry const * entry = FindRoute (id);
+  if (entry == 0)
     {
-      NS_LOG_LOGIC ("Route to " << id << " not found; m_ipv4AddressEntry is empty");
       return false;
     }
-  std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
-    m_ipv4AddressEntry.find (id);
-  if (i == m_ipv4AddressEntry.end ())
-    {
-      NS_LOG_LOGIC ("Route to " << id << " not found");
-      return false;
-    }
-  rt = i->second;
-  NS_LOG_LOGIC ("Route to " << id << " found");
+  rt = *entry;
   return true;
 }
 
@@ -245,13 +606,130 @@ RoutingTable::LookupValidRoute (Ipv4Address id, RoutingTableEntry & rt)
   return (rt.GetFlag () == VALID);
 }
 
+RoutingTableEntry const *
+RoutingTable::FindRoute (Ipv4Address id)
+{
+  NS_LOG_FUNCTION (this << id);
+  if (m_ipv4AddressEntry.empty ())
+    {
+      NS_LOG_LOGIC ("Route to " << id << " not found; m_ipv4AddressEntry is empty");
+      return 0;
+    }
+  std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+    FindEntry (id);
+  if (i == m_ipv4AddressEntry.end () || !PurgeEntry (i))
+    {
+      NS_LOG_LOGIC ("Route to " << id << " not found");
+      return 0;
+    }
+  NS_LOG_LOGIC ("Route to " << id << " found");
+  return &i->second;
+}
+
+RoutingTableEntry const *
+RoutingTable::FindRouteById (NodeId id)
+{
+  NS_LOG_FUNCTION (this << id);
+  std::map<Ipv4Address, RoutingTableEntry>::iterator i = FindEntryById (id);
+  if (i == m_ipv4AddressEntry.end () || !PurgeEntry (i))
+    {
+      NS_LOG_LOGIC ("Route to node " << id << " not found");
+      return 0;
+    }
+  return &i->second;
+}
+
+RoutingTableEntry const *
+RoutingTable::FindValidRoute (Ipv4Address id)
+{
+  NS_LOG_FUNCTION (this << id);
+  RoutingTableEntry const * entry = FindRoute (id);
+  if (entry == 0 || entry->GetFlag () != VALID)
+    {
+      return 0;
+    }
+  return entry;
+}
+
+bool
+RoutingTable::RefreshRoute (Ipv4Address id, Time lifetime, Ipv4Address nextHop)
+{
+  NS_LOG_FUNCTION (this << id << lifetime);
+  std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+    FindEntry (id);
+  if (i == m_ipv4AddressEntry.end () || !PurgeEntry (i) || i->second.GetFlag () != VALID)
+    {
+      return false;
+    }
+  RefreshEntry (i->second, lifetime, nextHop);
+  return true;
+}
+
+Ipv4Address
+RoutingTable::RefreshForwardingPath (RoutingTableEntry const * toDst, Ipv4Address nextHop,
+                                     Ipv4Address origin, Time lifetime)
+{
+  NS_LOG_FUNCTION (this << origin << nextHop << lifetime);
+  NS_ASSERT (toDst != 0 && toDst->GetFlag () == VALID);
+  Ipv4Address dst = toDst->GetDestination ();
+  Ipv4Address prevHop;
+  // Resolve the reverse route first: expiring it may delete entries, but never toDst
+  if (origin != dst)
+    {
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+        FindEntry (origin);
+      if (i != m_ipv4AddressEntry.end () && PurgeEntry (i))
+        {
+          prevHop = i->second.GetNextHop ();
+          if (i->second.GetFlag () == VALID)
+            {
+              RefreshEntry (i->second, lifetime, Ipv4Address ());
+            }
+        }
+    }
+  std::map<Ipv4Address, RoutingTableEntry>::iterator d = FindEntryById (toDst->m_nodeId);
+  NS_ASSERT (d != m_ipv4AddressEntry.end () && &d->second == toDst);
+  RefreshEntry (d->second, lifetime, nextHop);
+  if (nextHop != dst)
+    {
+      RefreshRoute (nextHop, lifetime);
+    }
+  if (prevHop != Ipv4Address () && prevHop != origin && prevHop != nextHop && prevHop != dst)
+    {
+      RefreshRoute (prevHop, lifetime);
+    }
+  return prevHop;
+}
+
+void
+RoutingTable::RefreshEntry (RoutingTableEntry & rt, Time lifetime, Ipv4Address nextHop)
+{
+  rt.SetRreqCnt (0);
+  rt.SetLifeTime (std::max (lifetime, rt.GetLifeTime ()));
+  // Only the next hop named by the caller carried a data packet
+  bool reinforce = nextHop != Ipv4Address ();
+  if (!reinforce)
+    {
+      nextHop = rt.GetNextHop ();
+    }
+  rt.RefreshNextHop (nextHop, lifetime);
+  if (reinforce && m_deposit > 0)
+    {
+      rt.ReinforceNextHop (nextHop, m_deposit, m_reinforcementInterval);
+    }
+  IndexExpiry (rt);
+}
+
 bool
 RoutingTable::DeleteRoute (Ipv4Address dst)
 {
   NS_LOG_FUNCTION (this << dst);
-  Purge ();
-  if (m_ipv4AddressEntry.erase (dst) != 0)
+  std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+    FindEntry (dst);
+  if (i != m_ipv4AddressEntry.end ())
     {
+      EraseEntry (i);
+      NotifyRouteChange (dst);
       NS_LOG_LOGIC ("Route deletion to " << dst << " successful");
       return true;
     }
@@ -263,13 +741,35 @@ bool
 RoutingTable::AddRoute (RoutingTableEntry & rt)
 {
   NS_LOG_FUNCTION (this);
-  Purge ();
+  std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+    FindEntry (rt.GetDestination ());
+  if (i != m_ipv4AddressEntry.end ())
+    {
+      // An outdated entry for the same destination does not block the new one
+      PurgeEntry (i);
+    }
   if (rt.GetFlag () != IN_SEARCH)
     {
       rt.SetRreqCnt (0);
     }
+  rt.SetEvaporation (m_decay, m_evaporationRate);
+  ApplyLinkQuality (rt);
   std::pair<std::map<Ipv4Address, RoutingTableEntry>::iterator, bool> result =
     m_ipv4AddressEntry.insert (std::make_pair (rt.GetDestination (), rt));
+  if (result.second)
+    {
+      NodeId id = NodeIdMap::Intern (result.first->first);
+      if (id >= m_idIndex.size ())
+        {
+          m_idIndex.resize (id + 1, m_ipv4AddressEntry.end ());
+        }
+      m_idIndex[id] = result.first;
+      result.first->second.m_nodeId = id;
+      result.first->second.m_indexedExpiry = Time::Max ();
+      IndexExpiry (result.first->second);
+      IndexNextHops (result.first);
+      NotifyRouteChange (result.first->first);
+    }
   return result.second;
 }
 
@@ -278,13 +778,22 @@ RoutingTable::Update (RoutingTableEntry & rt)
 {
   NS_LOG_FUNCTION (this);
   std::map<Ipv4Address, RoutingTableEntry>::iterator i =
-    m_ipv4AddressEntry.find (rt.GetDestination ());
+    FindEntry (rt.GetDestination ());
   if (i == m_ipv4AddressEntry.end ())
     {
       NS_LOG_LOGIC ("Route update to " << rt.GetDestination () << " fails; not found");
       return false;
     }
+  Time indexedExpiry = i->second.m_indexedExpiry;
+  NodeId id = i->second.m_nodeId;
   i->second = rt;
+  i->second.m_indexedExpiry = indexedExpiry;
+  i->second.m_nodeId = id;
+  IndexExpiry (i->second);
+  IndexNextHops (i);
+  i->second.SetEvaporation (m_decay, m_evaporationRate);
+  ApplyLinkQuality (i->second);
+  NotifyRouteChange (i->first);
   if (i->second.GetFlag () != IN_SEARCH)
     {
       NS_LOG_LOGIC ("Route update to " << rt.GetDestination () << " set RreqCnt to 0");
@@ -298,7 +807,7 @@ RoutingTable::SetEntryState (Ipv4Address id, RouteFlags state)
 {
   NS_LOG_FUNCTION (this);
   std::map<Ipv4Address, RoutingTableEntry>::iterator i =
-    m_ipv4AddressEntry.find (id);
+    FindEntry (id);
   if (i == m_ipv4AddressEntry.end ())
     {
       NS_LOG_LOGIC ("Route set entry state to " << id << " fails; not found");
@@ -306,6 +815,8 @@ RoutingTable::SetEntryState (Ipv4Address id, RouteFlags state)
     }
   i->second.SetFlag (state);
   i->second.SetRreqCnt (0);
+  IndexExpiry (i->second);
+  NotifyRouteChange (id);
   NS_LOG_LOGIC ("Route set entry state to " << id << ": new state is " << state);
   return true;
 }
@@ -316,15 +827,136 @@ RoutingTable::GetListOfDestinationWithNextHop (Ipv4Address nextHop, std::map<Ipv
   NS_LOG_FUNCTION (this);
   Purge ();
   unreachable.clear ();
-  for (std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
-         m_ipv4AddressEntry.begin (); i != m_ipv4AddressEntry.end (); ++i)
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator n = m_nextHopIndex.find (nextHop);
+  if (n == m_nextHopIndex.end ())
+    {
+      return;
+    }
+  for (std::set<Ipv4Address>::iterator j = n->second.begin (); j != n->second.end (); )
     {
+      std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
+        FindEntry (*j);
+      if (i == m_ipv4AddressEntry.end () || !i->second.HasNextHop (nextHop))
+        {
+          n->second.erase (j++);
+          continue;
+        }
       if (i->second.GetNextHop () == nextHop)
         {
           NS_LOG_LOGIC ("Unreachable insert " << i->first << " " << i->second.GetSeqNo ());
           unreachable.insert (std::make_pair (i->first, i->second.GetSeqNo ()));
         }
+      ++j;
+    }
+  if (n->second.empty ())
+    {
+      m_nextHopIndex.erase (n);
+    }
+}
+
+void
+RoutingTable::FailOverNextHop (Ipv4Address nextHop, std::map<Ipv4Address, uint32_t> & unreachable,
+                               std::vector<Ipv4Address> & switched)
+{
+  NS_LOG_FUNCTION (this << nextHop);
+  Purge ();
+  unreachable.clear ();
+  switched.clear ();
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator n = m_nextHopIndex.find (nextHop);
+  if (n == m_nextHopIndex.end ())
+    {
+      return;
+    }
+  for (std::set<Ipv4Address>::iterator j = n->second.begin (); j != n->second.end (); )
+    {
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i = FindEntry (*j);
+      if (i == m_ipv4AddressEntry.end () || !i->second.HasNextHop (nextHop))
+        {
+          n->second.erase (j++);
+          continue;
+        }
+      RoutingTableEntry & rt = i->second;
+      bool current = rt.GetNextHop () == nextHop;
+      rt.DeleteNextHop (nextHop);
+      rt.PurgeNextHops ();
+      if (!current)
+        {
+          // Only an alternative was lost
+          n->second.erase (j++);
+          continue;
+        }
+      if (rt.GetFlag () == VALID && rt.GetNextHopCount () > 0)
+        {
+          rt.SelectBestNextHop ();
+          NS_LOG_LOGIC ("Route to " << i->first << " fails over to " << rt.GetNextHop ());
+          IndexNextHops (i);
+          NotifyRouteChange (i->first);
+          switched.push_back (i->first);
+          n->second.erase (j++);
+          continue;
+        }
+      NS_LOG_LOGIC ("Unreachable insert " << i->first << " " << rt.GetSeqNo ());
+      unreachable.insert (std::make_pair (i->first, rt.GetSeqNo ()));
+      ++j;
+    }
+  if (n->second.empty ())
+    {
+      m_nextHopIndex.erase (n);
+    }
+}
+
+void
+RoutingTable::SetLinkQuality (Ipv4Address nextHop, double quality)
+{
+  NS_LOG_FUNCTION (this << nextHop << quality);
+  if (quality < 1)
+    {
+      m_linkQuality[nextHop] = quality;
+    }
+  else
+    {
+      m_linkQuality.erase (nextHop);
+    }
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator n = m_nextHopIndex.find (nextHop);
+  if (n == m_nextHopIndex.end ())
+    {
+      return;
+    }
+  for (std::set<Ipv4Address>::iterator j = n->second.begin (); j != n->second.end (); )
+    {
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i = FindEntry (*j);
+      if (i == m_ipv4AddressEntry.end () || !i->second.SetNextHopLinkQuality (nextHop, quality))
+        {
+          n->second.erase (j++);
+          continue;
+        }
+      Ipv4Address gateway = i->second.GetNextHop ();
+      if (i->second.GetNextHopCount () > 1 && i->second.SelectBestNextHop ()
+          && i->second.GetNextHop () != gateway)
+        {
+          NotifyRouteChange (i->first);
+        }
+      ++j;
+    }
+  if (n->second.empty ())
+    {
+      m_nextHopIndex.erase (n);
+    }
+}
+
+void
+RoutingTable::ApplyLinkQuality (RoutingTableEntry & rt) const
+{
+  if (m_linkQuality.empty ())
+    {
+      return;
+    }
+  for (std::vector<RoutingTableEntry::NextHop>::iterator i = rt.m_nextHops.begin (); i != rt.m_nextHops.end (); ++i)
+    {
+      std::map<Ipv4Address, double>::const_iterator q = m_linkQuality.find (i->m_nextHop);
+      i->m_linkQuality = q == m_linkQuality.end () ? 1 : q->second;
     }
+  rt.UpdateCumulativePheromone ();
 }
 
 void
@@ -332,17 +964,17 @@ RoutingTable::InvalidateRoutesWithDst (const std::map<Ipv4Address, uint32_t> & u
 {
   NS_LOG_FUNCTION (this);
   Purge ();
-  for (std::map<Ipv4Address, RoutingTableEntry>::iterator i =
-         m_ipv4AddressEntry.begin (); i != m_ipv4AddressEntry.end (); ++i)
+  for (std::map<Ipv4Address, uint32_t>::const_iterator j =
+         unreachable.begin (); j != unreachable.end (); ++j)
     {
-      for (std::map<Ipv4Address, uint32_t>::const_iterator j =
-             unreachable.begin (); j != unreachable.end (); ++j)
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+        FindEntry (j->first);
+      if ((i != m_ipv4AddressEntry.end ()) && (i->second.GetFlag () == VALID))
         {
-          if ((i->first == j->first) && (i->second.GetFlag () == VALID))
-            {
-              NS_LOG_LOGIC ("Invalidate route with destination address " << i->first);
-              i->second.Invalidate (m_badLinkLifetime);
-            }
+          NS_LOG_LOGIC ("Invalidate route with destination address " << i->first);
+          i->second.Invalidate (m_badLinkLifetime);
+          IndexExpiry (i->second);
+          NotifyRouteChange (i->first);
         }
     }
 }
@@ -351,22 +983,36 @@ void
 RoutingTable::DeleteAllRoutesFromInterface (Ipv4InterfaceAddress iface)
 {
   NS_LOG_FUNCTION (this);
-  if (m_ipv4AddressEntry.empty ())
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator n =
+    m_interfaceIndex.find (iface.GetLocal ());
+  if (n == m_interfaceIndex.end ())
     {
       return;
     }
-  for (std::map<Ipv4Address, RoutingTableEntry>::iterator i =
-         m_ipv4AddressEntry.begin (); i != m_ipv4AddressEntry.end (); )
+  std::set<Ipv4Address> destinations;
+  destinations.swap (n->second);
+  m_interfaceIndex.erase (n);
+  for (std::set<Ipv4Address>::const_iterator j = destinations.begin (); j != destinations.end (); ++j)
     {
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+        FindEntry (*j);
+      if (i == m_ipv4AddressEntry.end ())
+        {
+          continue;
+        }
       if (i->second.GetInterface () == iface)
         {
-          std::map<Ipv4Address, RoutingTableEntry>::iterator tmp = i;
-          ++i;
-          m_ipv4AddressEntry.erase (tmp);
+          EraseEntry (i);
+          NotifyRouteChange (*j);
         }
       else
         {
-          ++i;
+          if (i->second.DeleteNextHopsFromInterface (iface))
+            {
+              NotifyRouteChange (*j);
+            }
+          // Entries on another interface with the same local address stay indexed
+          IndexNextHops (i);
         }
     }
 }
@@ -375,35 +1021,164 @@ void
 RoutingTable::Purge ()
 {
   NS_LOG_FUNCTION (this);
-  if (m_ipv4AddressEntry.empty ())
+  Time now = Simulator::Now ();
+  while (!m_expiryIndex.empty () && m_expiryIndex.top ().first < now)
     {
-      return;
+      ExpiryRecord record = m_expiryIndex.top ();
+      m_expiryIndex.pop ();
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+        FindEntry (record.second);
+      if (i == m_ipv4AddressEntry.end () || i->second.m_indexedExpiry != record.first)
+        {
+          // The entry was deleted or has been indexed again since
+          continue;
+        }
+      i->second.m_indexedExpiry = Time::Max ();
+      if (PurgeEntry (i))
+        {
+          IndexExpiry (i->second);
+        }
     }
+}
+
+bool
+RoutingTable::PurgeEntry (std::map<Ipv4Address, RoutingTableEntry>::iterator i)
+{
+  if (i->second.GetLifeTime () < Seconds (0))
+    {
+      if (i->second.GetFlag () == INVALID)
+        {
+          NS_LOG_LOGIC ("Delete route with destination address " << i->first);
+          Ipv4Address dst = i->first;
+          EraseEntry (i);
+          NotifyRouteChange (dst);
+          return false;
+        }
+      else if (i->second.GetFlag () == VALID)
+        {
+          NS_LOG_LOGIC ("Invalidate route with destination address " << i->first);
+          i->second.Invalidate (m_badLinkLifetime);
+          IndexExpiry (i->second);
+          NotifyRouteChange (i->first);
+        }
+    }
+  if (i->second.PurgeNextHops ())
+    {
+      NotifyRouteChange (i->first);
+    }
+  return true;
+}
+
+std::map<Ipv4Address, RoutingTableEntry>::iterator
+RoutingTable::FindEntry (Ipv4Address dst)
+{
+  if (m_idGeneration != NodeIdMap::GetGeneration ())
+    {
+      RebuildIdIndex ();
+    }
+  return FindEntryById (NodeIdMap::Lookup (dst));
+}
+
+std::map<Ipv4Address, RoutingTableEntry>::iterator
+RoutingTable::FindEntryById (NodeId id)
+{
+  if (m_idGeneration != NodeIdMap::GetGeneration ())
+    {
+      RebuildIdIndex ();
+    }
+  if (id == NodeIdMap::NONE || id >= m_idIndex.size ())
+    {
+      return m_ipv4AddressEntry.end ();
+    }
+  return m_idIndex[id];
+}
+
+void
+RoutingTable::EraseEntry (std::map<Ipv4Address, RoutingTableEntry>::iterator i)
+{
+  UnindexNextHops (i);
+  NS_ASSERT (i->second.m_nodeId < m_idIndex.size ());
+  m_idIndex[i->second.m_nodeId] = m_ipv4AddressEntry.end ();
+  m_ipv4AddressEntry.erase (i);
+}
+
+void
+RoutingTable::RebuildIdIndex ()
+{
+  m_idGeneration = NodeIdMap::GetGeneration ();
+  m_idIndex.clear ();
   for (std::map<Ipv4Address, RoutingTableEntry>::iterator i =
-         m_ipv4AddressEntry.begin (); i != m_ipv4AddressEntry.end (); )
+         m_ipv4AddressEntry.begin (); i != m_ipv4AddressEntry.end (); ++i)
     {
-      if (i->second.GetLifeTime () < Seconds (0))
+      NodeId id = NodeIdMap::Intern (i->first);
+      if (id >= m_idIndex.size ())
         {
-          if (i->second.GetFlag () == INVALID)
-            {
-              std::map<Ipv4Address, RoutingTableEntry>::iterator tmp = i;
-              ++i;
-              m_ipv4AddressEntry.erase (tmp);
-            }
-          else if (i->second.GetFlag () == VALID)
-            {
-              NS_LOG_LOGIC ("Invalidate route with destination address " << i->first);
-              i->second.Invalidate (m_badLinkLifetime);
-              ++i;
-            }
-          else
-            {
-              ++i;
-            }
+          m_idIndex.resize (id + 1, m_ipv4AddressEntry.end ());
         }
-      else
+      m_idIndex[id] = i;
+      i->second.m_nodeId = id;
+    }
+}
+
+void
+RoutingTable::IndexExpiry (RoutingTableEntry & rt)
+{
+  Time deadline = rt.m_lifeTime;
+  if (rt.GetFlag () == IN_SEARCH && deadline < Simulator::Now ())
+    {
+      // Purge leaves such entries alone; they are indexed again when updated
+      return;
+    }
+  if (deadline < rt.m_indexedExpiry)
+    {
+      m_expiryIndex.push (std::make_pair (deadline, rt.GetDestination ()));
+      rt.m_indexedExpiry = deadline;
+    }
+}
+
+void
+RoutingTable::IndexNextHops (std::map<Ipv4Address, RoutingTableEntry>::iterator i)
+{
+  RoutingTableEntry const & rt = i->second;
+  if (rt.GetNextHop () != Ipv4Address ())
+    {
+      m_nextHopIndex[rt.GetNextHop ()].insert (i->first);
+    }
+  if (rt.GetInterface ().GetLocal () != Ipv4Address ())
+    {
+      m_interfaceIndex[rt.GetInterface ().GetLocal ()].insert (i->first);
+    }
+  for (uint32_t k = 0; k < rt.m_nextHops.size (); ++k)
+    {
+      m_nextHopIndex[rt.m_nextHops[k].m_nextHop].insert (i->first);
+      m_interfaceIndex[rt.m_nextHopOutputs[k].m_iface.GetLocal ()].insert (i->first);
+    }
+}
+
+void
+RoutingTable::UnindexNextHops (std::map<Ipv4Address, RoutingTableEntry>::iterator i)
+{
+  RoutingTableEntry const & rt = i->second;
+  EraseIndexRecord (m_nextHopIndex, rt.GetNextHop (), i->first);
+  EraseIndexRecord (m_interfaceIndex, rt.GetInterface ().GetLocal (), i->first);
+  for (uint32_t k = 0; k < rt.m_nextHops.size (); ++k)
+    {
+      EraseIndexRecord (m_nextHopIndex, rt.m_nextHops[k].m_nextHop, i->first);
+      EraseIndexRecord (m_interfaceIndex, rt.m_nextHopOutputs[k].m_iface.GetLocal (), i->first);
+    }
+}
+
+void
+RoutingTable::EraseIndexRecord (std::map<Ipv4Address, std::set<Ipv4Address> > & index,
+                                Ipv4Address key, Ipv4Address dst)
+{
+  std::map<Ipv4Address, std::set<Ipv4Address> >::iterator n = index.find (key);
+  if (n != index.end ())
+    {
+      n->second.erase (dst);
+      if (n->second.empty ())
         {
-          ++i;
+          index.erase (n);
         }
     }
 }
@@ -440,6 +1215,7 @@ RoutingTable::Purge (std::map<Ipv4Address, RoutingTableEntry> &table) const
         }
       else
         {
+          i->second.PurgeNextHops ();
           ++i;
         }
     }
@@ -450,7 +1226,7 @@ RoutingTable::MarkLinkAsUnidirectional (Ipv4Address neighbor, Time blacklistTime
 {
   NS_LOG_FUNCTION (this << neighbor << blacklistTimeout.GetSeconds ());
   std::map<Ipv4Address, RoutingTableEntry>::iterator i =
-    m_ipv4AddressEntry.find (neighbor);
+    FindEntry (neighbor);
   if (i == m_ipv4AddressEntry.end ())
     {
       NS_LOG_LOGIC ("Mark link unidirectional to  " << neighbor << " fails; not found");
@@ -469,7 +1245,7 @@ RoutingTable::Print (Ptr<OutputStreamWrapper> stream) const
   std::map<Ipv4Address, RoutingTableEntry> table = m_ipv4AddressEntry;
   Purge (table);
   *stream->GetStream () << "\nARA Routing table\n"
-                        << "Destination\tGateway\t\tInterface\tFlag\tExpire\t\tPheromone\n";
+                        << "Destination\tGateway\t\tInterface\tFlag\tExpire\t\tHops\tNext hops (pheromone)\n";
   for (std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
          table.begin (); i != table.end (); ++i)
     {
@@ -31,12 +31,20 @@
 #include <stdint.h>
 #include <cassert>
 #include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <functional>
 #include <sys/types.h>
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/timer.h"
 #include "ns3/net-device.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/callback.h"
+#include "ara-node-id.h"
 
 namespace ns3 {
 namespace ara {
@@ -52,6 +60,20 @@ enum RouteFlags
   IN_SEARCH = 2,      //!< IN_SEARCH
 };
 
+/**
+ * \ingroup ara
+ * \brief Pheromone evaporation curves
+ *
+ * Evaporation is not driven by timers. Each next hop record remembers when its
+ * pheromone was last set and the decayed value is computed when it is read.
+ */
+enum PheromoneDecay
+{
+  DECAY_NONE = 0,         //!< Pheromone does not evaporate
+  DECAY_EXPONENTIAL = 1,  //!< A fixed fraction of the pheromone evaporates per second
+  DECAY_LINEAR = 2,       //!< A fixed amount of pheromone evaporates per second
+};
+
 /**
  * \ingroup aodv
  * \brief Routing table entry
@@ -67,16 +89,169 @@ public:
    * \param vSeqNo verify sequence number flag
    * \param seqNo the sequence number
    * \param iface the interface
-   * \param pheromone the number of hops
+   * \param hops the number of hops
    * \param nextHop the IP address of the next hop
    * \param lifetime the lifetime of the entry
    */
   RoutingTableEntry (Ptr<NetDevice> dev = 0,Ipv4Address dst = Ipv4Address (), bool vSeqNo = false, uint32_t seqNo = 0,
-                     Ipv4InterfaceAddress iface = Ipv4InterfaceAddress (), uint16_t  pheromone = 0,
+                     Ipv4InterfaceAddress iface = Ipv4InterfaceAddress (), uint16_t  hops = 0,
                      Ipv4Address nextHop = Ipv4Address (), Time lifetime = Simulator::Now ());
 
   ~RoutingTableEntry ();
 
+  /**
+   * Pheromone record of one next hop towards the destination.  Only what next
+   * hop selection reads is kept here; the output interface and route of the
+   * next hop are stored apart, see NextHopOutput.
+   */
+  struct NextHop
+  {
+    /// Next hop IPv4 address
+    Ipv4Address m_nextHop;
+    /// Pheromone value of the link through this next hop at m_lastUpdate
+    double m_pheromone;
+    /// Time m_pheromone was last set
+    Time m_lastUpdate;
+    /// Expiration time of the record
+    Time m_expire;
+    /// Estimated delivery ratio of the link to the next hop, scales the pheromone when read
+    double m_linkQuality;
+    /// Time data traffic last deposited pheromone on the record
+    Time m_lastReinforcement;
+
+    /**
+     * \brief NextHop structure constructor
+     *
+     * \param nextHop the IP address of the next hop
+     * \param pheromone the pheromone value
+     * \param expire the expiration time
+     */
+    NextHop (Ipv4Address nextHop, double pheromone, Time expire)
+      : m_nextHop (nextHop),
+        m_pheromone (pheromone),
+        m_lastUpdate (Simulator::Now ()),
+        m_expire (expire),
+        m_linkQuality (1),
+        m_lastReinforcement (Time::Min ())
+    {
+    }
+  };
+
+  ///\name Pheromone table management
+  //\{
+  /**
+   * Add a next hop record, or refresh the existing one for the same next hop
+   * \param nextHop the IP address of the next hop
+   * \param dev the output device
+   * \param iface the output interface address
+   * \param pheromone the pheromone value of the link
+   * \param lifetime the lifetime of the record
+   * \return true if a new record was added
+   */
+  bool AddNextHop (Ipv4Address nextHop, Ptr<NetDevice> dev, Ipv4InterfaceAddress iface,
+                   double pheromone, Time lifetime);
+  /**
+   * Delete the record of the next hop
+   * \param nextHop the IP address of the next hop
+   * \return true on success
+   */
+  bool DeleteNextHop (Ipv4Address nextHop);
+  /**
+   * Extend the lifetime of the next hop record to at least lifetime
+   * \param nextHop the IP address of the next hop
+   * \param lifetime the proposed lifetime
+   * \return true if the record exists
+   */
+  bool RefreshNextHop (Ipv4Address nextHop, Time lifetime);
+  /**
+   * Get the current (evaporated) pheromone value of the next hop, scaled by
+   * the delivery ratio of the link to it
+   * \param nextHop the IP address of the next hop
+   * \return the pheromone value, zero if there is no such record
+   */
+  double GetNextHopPheromone (Ipv4Address nextHop) const;
+  /**
+   * Set the delivery ratio of the link to the next hop
+   * \param nextHop the IP address of the next hop
+   * \param quality the delivery ratio, in [0, 1]
+   * \return true if the record exists
+   */
+  bool SetNextHopLinkQuality (Ipv4Address nextHop, double quality);
+  /**
+   * Deposit pheromone on the next hop record for data traffic using it.
+   * Deposits within interval of the previous one are coalesced into it.
+   * \param nextHop the IP address of the next hop
+   * \param deposit the amount of pheromone added
+   * \param interval the minimum time between two deposits
+   * \return true if pheromone was deposited
+   */
+  bool ReinforceNextHop (Ipv4Address nextHop, double deposit, Time interval);
+  /**
+   * Check whether the destination can be reached through the next hop
+   * \param nextHop the IP address of the next hop
+   * \return true if nextHop is the current next hop or has a record
+   */
+  bool HasNextHop (Ipv4Address nextHop) const;
+  /**
+   * Set the pheromone evaporation curve
+   * \param decay the evaporation curve
+   * \param rate the evaporated fraction (exponential) or amount (linear) per second
+   */
+  void SetEvaporation (PheromoneDecay decay, double rate);
+  /**
+   * Get the next hop records
+   * \return the pheromone table of this destination
+   */
+  std::vector<NextHop> const & GetNextHops () const
+  {
+    return m_nextHops;
+  }
+  /**
+   * Get the number of next hop records
+   * \return the number of next hops
+   */
+  uint32_t GetNextHopCount () const
+  {
+    return m_nextHops.size ();
+  }
+  /**
+   * Delete all expired next hop records. If the record of the current next hop
+   * has gone, the remaining next hop with the highest pheromone takes its place.
+   * \return true if any record was deleted
+   */
+  bool PurgeNextHops ();
+  /**
+   * Delete all next hop records going out through the interface
+   * \param iface the interface address
+   * \return true if any record was deleted
+   */
+  bool DeleteNextHopsFromInterface (Ipv4InterfaceAddress iface);
+  /**
+   * Make the next hop with the highest pheromone the current next hop
+   * \return false if there are no next hop records
+   */
+  bool SelectBestNextHop ();
+  /**
+   * Pick a next hop at random with probability proportional to its pheromone.
+   * Costs O(log k) in the number of next hops k without evaporation or with
+   * exponential evaporation, which keep the running sum of pheromone valid.
+   * Linear evaporation changes the ratios between next hops over time, so
+   * every next hop is weighed again and the cost is O(k).
+   * \param u uniform random number in [0, 1)
+   * \return the route through the chosen next hop, or the current route if there are no records
+   */
+  Ptr<Ipv4Route> SelectRoute (double u) const;
+  /**
+   * Initial pheromone of a path discovered with the given length
+   * \param hops the number of hops
+   * \return the pheromone value
+   */
+  static double GetInitialPheromone (uint16_t hops)
+  {
+    return 1.0 / std::max<uint16_t> (hops, 1);
+  }
+  //\}
+
   ///\name Precursors management
   //\{
   /**
@@ -109,6 +284,11 @@ public:
    * \param prec vector of precursor addresses
    */
   void GetPrecursors (std::vector<Ipv4Address> & prec) const;
+  /**
+   * Adds the precursors to the output parameter prec
+   * \param prec set of precursor node IDs
+   */
+  void GetPrecursors (NodeIdSet & prec) const;
   //\}
 
   /**
@@ -223,20 +403,20 @@ public:
     return m_seqNo;
   }
   /**
-   * Set the pheromone value
-   * \param pheromone the number of hops
+   * Set the number of hops
+   * \param hop the number of hops
    */
-  void SetPheromone (uint16_t pheromone)
+  void SetHop (uint16_t hop)
   {
-    m_pheromone = pheromone;
+    m_hops = hop;
   }
   /**
-   * Get the pheromone value
-   * \returns the pheromone value
+   * Get the number of hops
+   * \returns the number of hops
    */
-  uint16_t GetPheromone () const
+  uint16_t GetHop () const
   {
-    return m_pheromone;
+    return m_hops;
   }
   /**
    * Set the lifetime
@@ -348,8 +528,8 @@ private:
   bool m_validSeqNo;
   /// Destination Sequence Number, if m_validSeqNo = true
   uint32_t m_seqNo;
-  /// Pheromone Count (number of hops needed to reach destination)
-  uint16_t m_pheromone;
+  /// Hop Count (number of hops needed to reach destination)
+  uint16_t m_hops;
   /**
   * \brief Expiration or deletion time of the route
   *	Lifetime field in the routing table plays dual role:
@@ -357,6 +537,10 @@ private:
   *	it is the deletion time.
   */
   Time m_lifeTime;
+  /// Deadline of the earliest expiry index record of this entry, Time::Max () if none
+  Time m_indexedExpiry;
+  /// Node ID of the destination in the routing table's ID index
+  NodeId m_nodeId;
   /** Ip route, include
    *   - destination address
    *   - source address
@@ -369,8 +553,62 @@ private:
   /// Routing flags: valid, invalid or in search
   RouteFlags m_flag;
 
-  /// List of precursors
-  std::vector<Ipv4Address> m_precursorList;
+  /// Output of a next hop record, only read once the next hop is chosen
+  struct NextHopOutput
+  {
+    /// Output interface address
+    Ipv4InterfaceAddress m_iface;
+    /// Route to the destination through the next hop
+    Ptr<Ipv4Route> m_route;
+
+    /**
+     * \brief NextHopOutput structure constructor
+     *
+     * \param iface the output interface address
+     * \param route the route through the next hop
+     */
+    NextHopOutput (Ipv4InterfaceAddress iface, Ptr<Ipv4Route> route)
+      : m_iface (iface),
+        m_route (route)
+    {
+    }
+  };
+  /// Pheromone table: one record per known next hop, stored contiguously
+  std::vector<NextHop> m_nextHops;
+  /// Output of each record of m_nextHops, at the same position
+  std::vector<NextHopOutput> m_nextHopOutputs;
+  /**
+   * Delete a next hop record and its output
+   * \param k the position of the record
+   */
+  void EraseNextHop (uint32_t k);
+  /// Running sum of m_nextHops pheromone values, rebuilt whenever a pheromone value changes
+  std::vector<double> m_cumulativePheromone;
+  /// Rebuild m_cumulativePheromone
+  void UpdateCumulativePheromone ();
+  /// Pheromone evaporation curve
+  PheromoneDecay m_decay;
+  /// Evaporated fraction (exponential) or amount (linear) of pheromone per second
+  double m_evaporationRate;
+  /**
+   * Evaporate the pheromone of a next hop record up to now
+   * \param nextHop the next hop record
+   * \param now the current time
+   * \return the current pheromone value
+   */
+  double Evaporate (NextHop const & nextHop, Time now) const;
+  /**
+   * Weigh a next hop record for next hop selection
+   * \param nextHop the next hop record
+   * \param now the current time
+   * \return the current pheromone value scaled by the link delivery ratio
+   */
+  double Weigh (NextHop const & nextHop, Time now) const
+  {
+    return Evaporate (nextHop, now) * nextHop.m_linkQuality;
+  }
+  /// Set of precursors
+  NodeIdSet m_precursors;
   /// When I can send another request
   Time m_routeRequestTimout;
   /// Number of route requests
@@ -379,6 +617,8 @@ private:
   bool m_blackListState;
   /// Time for which the node is put into the blacklist
   Time m_blackListTimeout;
+
+  friend class RoutingTable;
 };
 
 /**
@@ -391,8 +631,10 @@ public:
   /**
    * constructor
    * \param t the routing table entry lifetime
+   * \param decay the pheromone evaporation curve
+   * \param rate the pheromone evaporation rate
    */
-  RoutingTable (Time t);
+  RoutingTable (Time t, PheromoneDecay decay = DECAY_NONE, double rate = 0);
   ///\name Handle lifetime of invalid route
   //\{
   Time GetBadLinkLifetime () const
@@ -404,6 +646,54 @@ public:
     m_badLinkLifetime = t;
   }
   //\}
+  ///\name Handle pheromone evaporation
+  //\{
+  PheromoneDecay GetPheromoneDecay () const
+  {
+    return m_decay;
+  }
+  /**
+   * Set the pheromone evaporation curve of the table and of all its entries
+   * \param decay the pheromone evaporation curve
+   */
+  void SetPheromoneDecay (PheromoneDecay decay);
+  double GetEvaporationRate () const
+  {
+    return m_evaporationRate;
+  }
+  /**
+   * Set the pheromone evaporation rate of the table and of all its entries
+   * \param rate the pheromone evaporation rate
+   */
+  void SetEvaporationRate (double rate);
+  //\}
+  ///\name Handle pheromone reinforcement by data traffic
+  //\{
+  double GetPheromoneDeposit () const
+  {
+    return m_deposit;
+  }
+  void SetPheromoneDeposit (double deposit)
+  {
+    m_deposit = deposit;
+  }
+  Time GetReinforcementInterval () const
+  {
+    return m_reinforcementInterval;
+  }
+  void SetReinforcementInterval (Time t)
+  {
+    m_reinforcementInterval = t;
+  }
+  //\}
+  /**
+   * Set the delivery ratio of the link to a neighbor. It applies to every
+   * record of the neighbor as next hop, present or added later, and routes
+   * with several next hops switch to the best weighed one.
+   * \param nextHop the IP address of the neighbor
+   * \param quality the delivery ratio, in [0, 1]
+   */
+  void SetLinkQuality (Ipv4Address nextHop, double quality);
   /**
    * Add routing table entry if it doesn't yet exist in routing table
    * \param r routing table entry
@@ -430,6 +720,51 @@ public:
    * \return true on success
    */
   bool LookupValidRoute (Ipv4Address dst, RoutingTableEntry & rt);
+  ///\name In-place access without copying entries
+  //\{
+  /**
+   * Find the routing table entry with destination address dst. The pointer
+   * stays valid until the entry is deleted from the table.
+   * \param dst destination address
+   * \return the entry, or 0 if there is none
+   */
+  RoutingTableEntry const * FindRoute (Ipv4Address dst);
+  /**
+   * Find the routing table entry of a destination by node ID, see NodeIdMap
+   * \param id node ID of the destination
+   * \return the entry, or 0 if there is none or id is NodeIdMap::NONE
+   */
+  RoutingTableEntry const * FindRouteById (NodeId id);
+  /**
+   * Find the routing table entry with destination address dst in VALID state
+   * \param dst destination address
+   * \return the entry, or 0 if there is no valid one
+   */
+  RoutingTableEntry const * FindValidRoute (Ipv4Address dst);
+  /**
+   * Extend the lifetime of a VALID entry to at least lifetime, reset its
+   * route request counter and refresh the record of the next hop in use
+   * \param dst destination address
+   * \param lifetime the proposed lifetime
+   * \param nextHop the next hop that carried a data packet, whose record is
+   *        reinforced as well; if not given the current next hop is only refreshed
+   * \return true if a VALID entry was refreshed
+   */
+  bool RefreshRoute (Ipv4Address dst, Time lifetime, Ipv4Address nextHop = Ipv4Address ());
+  /**
+   * Refresh every route used to forward a data packet, resolving each entry
+   * once: the route to the destination through nextHop, the route to nextHop,
+   * the route back to origin and the route to the previous hop on it.
+   * Only nextHop on the route to the destination is reinforced.
+   * \param toDst the VALID entry used to forward, as returned by FindRoute
+   * \param nextHop the next hop the packet is forwarded to
+   * \param origin the source of the packet
+   * \param lifetime the proposed lifetime
+   * \return the previous hop towards origin, or the default address if there is no route back
+   */
+  Ipv4Address RefreshForwardingPath (RoutingTableEntry const * toDst, Ipv4Address nextHop,
+                                     Ipv4Address origin, Time lifetime);
+  //\}
   /**
    * Update routing table
    * \param rt entry with destination address dst, if exists
@@ -445,11 +780,24 @@ public:
   bool SetEntryState (Ipv4Address dst, RouteFlags state);
   /**
    * Lookup routing entries with next hop Address dst and not empty list of precursors.
+   * Costs O(affected log N) through the next hop index.
    *
    * \param nextHop the next hop IP address
    * \param unreachable
    */
   void GetListOfDestinationWithNextHop (Ipv4Address nextHop, std::map<Ipv4Address, uint32_t> & unreachable);
+  /**
+   * Remove a broken next hop from every route. A VALID route that used it and
+   * still has other next hop records switches to the best of them; the other
+   * routes that used it are listed as unreachable, like
+   * GetListOfDestinationWithNextHop does.
+   *
+   * \param nextHop the next hop IP address
+   * \param unreachable the destinations left without a next hop, with their sequence numbers
+   * \param switched the destinations that switched to another next hop
+   */
+  void FailOverNextHop (Ipv4Address nextHop, std::map<Ipv4Address, uint32_t> & unreachable,
+                        std::vector<Ipv4Address> & switched);
   /**
    *   Update routing entries with this destination as follows:
    *  1. The destination sequence number of this routing entry, if it
@@ -468,8 +816,27 @@ public:
   void Clear ()
   {
     m_ipv4AddressEntry.clear ();
+    m_expiryIndex = ExpiryIndex ();
+    m_nextHopIndex.clear ();
+    m_interfaceIndex.clear ();
+    m_idIndex.clear ();
+    NotifyRouteChange (Ipv4Address::GetAny ());
+  }
+  /**
+   * Set the callback invoked with the destination whenever the route to it is
+   * added, changed, invalidated or deleted, or with the any address when all
+   * routes are deleted. Lifetime refreshes are not reported.
+   * \param cb the callback
+   */
+  void SetRouteChangeCallback (Callback<void, Ipv4Address> cb)
+  {
+    m_routeChangeCallback = cb;
   }
-  /// Delete all outdated entries and invalidate valid entry if Lifetime is expired
+  /**
+   * Delete all outdated entries and invalidate valid entry if Lifetime is expired.
+   * Only entries whose deadline has passed are visited, in deadline order.
+   * Lookups expire the entry they find by themselves.
+   */
   void Purge ();
   /** Mark entry as unidirectional (e.g. add this neighbor to "blacklist" for blacklistTimeout period)
    * \param neighbor - neighbor address link to which assumed to be unidirectional
@@ -488,6 +855,131 @@ private:
   std::map<Ipv4Address, RoutingTableEntry> m_ipv4AddressEntry;
   /// Deletion time for invalid routes
   Time m_badLinkLifetime;
+  /**
+   * Entry of each destination by node ID, end () if there is none. Every entry
+   * is indexed, so a destination without an ID has no entry.  The index only
+   * reaches the highest ID with an entry in this table, not every ID known to
+   * NodeIdMap, which is shared by all nodes.  A table with routes to most of
+   * the network still costs one iterator per node ID, on top of its entries.
+   * The entries themselves stay in m_ipv4AddressEntry: the index only makes
+   * lookups O(1), while adding and deleting an entry still costs a map node
+   * allocation and O(log n), and iteration still walks the map.
+   */
+  std::vector<std::map<Ipv4Address, RoutingTableEntry>::iterator> m_idIndex;
+  /// NodeIdMap generation m_idIndex was built for
+  uint32_t m_idGeneration;
+  /**
+   * Find the entry of a destination through the node ID index.  Resolving
+   * the address costs one hash probe in NodeIdMap, so only callers that
+   * already hold a node ID avoid hashing altogether.  Addresses are never
+   * interned here: an address without an ID has no entry.
+   * \param dst the destination
+   * \return the entry, or end () if there is none
+   */
+  std::map<Ipv4Address, RoutingTableEntry>::iterator FindEntry (Ipv4Address dst);
+  /**
+   * Find the entry of a destination by node ID
+   * \param id the node ID of the destination
+   * \return the entry, or end () if there is none
+   */
+  std::map<Ipv4Address, RoutingTableEntry>::iterator FindEntryById (NodeId id);
+  /**
+   * Delete an entry and remove it from all indexes
+   * \param i the entry
+   */
+  void EraseEntry (std::map<Ipv4Address, RoutingTableEntry>::iterator i);
+  /// Reassign node IDs to all entries after NodeIdMap was reset
+  void RebuildIdIndex ();
+  /// Not copyable: the indexes point into m_ipv4AddressEntry
+  RoutingTable (RoutingTable const &);
+  /// Not assignable: the indexes point into m_ipv4AddressEntry
+  RoutingTable & operator= (RoutingTable const &);
+  /// Route change notification
+  Callback<void, Ipv4Address> m_routeChangeCallback;
+  /**
+   * Report a route change
+   * \param dst the destination whose route changed
+   */
+  void NotifyRouteChange (Ipv4Address dst)
+  {
+    if (!m_routeChangeCallback.IsNull ())
+      {
+        m_routeChangeCallback (dst);
+      }
+  }
+  /// Pheromone evaporation curve applied to all entries
+  PheromoneDecay m_decay;
+  /// Evaporated fraction (exponential) or amount (linear) of pheromone per second
+  double m_evaporationRate;
+  /// Pheromone deposited by data traffic per reinforcement interval, 0 disables reinforcement
+  double m_deposit;
+  /// Minimum time between two deposits on the same next hop record
+  Time m_reinforcementInterval;
+  /// Delivery ratio of the links to neighbors, if below 1
+  std::map<Ipv4Address, double> m_linkQuality;
+  /**
+   * Apply the known link delivery ratios to the next hop records of an entry
+   * \param rt the entry
+   */
+  void ApplyLinkQuality (RoutingTableEntry & rt) const;
+  /// Apply the pheromone evaporation curve and rate of the table to all its entries
+  void ApplyEvaporation ();
+  /**
+   * Expire a single entry: invalidate it if it is valid and its lifetime is over,
+   * or delete it if it is invalid and its lifetime is over.
+   * \param i the entry
+   * \return false if the entry was deleted
+   */
+  bool PurgeEntry (std::map<Ipv4Address, RoutingTableEntry>::iterator i);
+  /// Expiry index record: absolute deadline of an entry and its destination
+  typedef std::pair<Time, Ipv4Address> ExpiryRecord;
+  /// Min-heap of expiry index records, earliest deadline on top
+  typedef std::priority_queue<ExpiryRecord, std::vector<ExpiryRecord>, std::greater<ExpiryRecord> > ExpiryIndex;
+  /**
+   * Expiry index. Records are not removed when an entry changes or is deleted;
+   * Purge skips a record that no longer matches the entry's m_indexedExpiry.
+   * An entry whose deadline moves later keeps its earlier record, which is
+   * pushed again with the new deadline when it is popped.
+   */
+  ExpiryIndex m_expiryIndex;
+  /**
+   * Make sure the expiry index holds a record no later than the entry's deadline
+   * \param rt the entry
+   */
+  void IndexExpiry (RoutingTableEntry & rt);
+  /**
+   * Refresh a VALID entry in place, see RefreshRoute
+   * \param rt the entry
+   * \param lifetime the proposed lifetime
+   * \param nextHop the next hop that carried a data packet, reinforced; the current next hop if default
+   */
+  void RefreshEntry (RoutingTableEntry & rt, Time lifetime, Ipv4Address nextHop);
+  /**
+   * Destinations reachable through each next hop, current or recorded. The
+   * index may hold destinations that no longer use the next hop; these are
+   * dropped when the next hop is looked up in the index.
+   */
+  std::map<Ipv4Address, std::set<Ipv4Address> > m_nextHopIndex;
+  /// Destinations using each local interface address, maintained like m_nextHopIndex
+  std::map<Ipv4Address, std::set<Ipv4Address> > m_interfaceIndex;
+  /**
+   * Add the next hops and interfaces of the entry to the reverse indexes
+   * \param i the entry
+   */
+  void IndexNextHops (std::map<Ipv4Address, RoutingTableEntry>::iterator i);
+  /**
+   * Remove the next hops and interfaces of the entry from the reverse indexes
+   * \param i the entry
+   */
+  void UnindexNextHops (std::map<Ipv4Address, RoutingTableEntry>::iterator i);
+  /**
+   * Remove a destination from one key of a reverse index
+   * \param index the reverse index
+   * \param key the next hop or local interface address
+   * \param dst the destination
+   */
+  static void EraseIndexRecord (std::map<Ipv4Address, std::set<Ipv4Address> > & index,
+                                Ipv4Address key, Ipv4Address dst);
   /**
    * const version of Purge, for use by Print() method
    * \param table the routing table entry to purge
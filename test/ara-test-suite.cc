@@ -2,6 +2,31 @@
 
 // Include a header file from your module to test.
 #include "ns3/ara.h"
+#include "ns3/ara-packet.h"
+#include "ns3/ara-rtable.h"
+#include "ns3/ara-route-cache.h"
+#include "ns3/ara-rqueue.h"
+#include "ns3/ara-id-cache.h"
+#include "ns3/ara-dpd.h"
+#include "ns3/ara-neighbor.h"
+#include "ns3/ara-routing-protocol.h"
+#include "ns3/arp-cache.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ara-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/simple-net-device-helper.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/output-stream-wrapper.h"
+#include <iostream>
+#include <sstream>
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -46,6 +71,1995 @@ AraTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// BANT header serialization with and without the FANT ID
+class AraBantHeaderTestCase : public TestCase
+{
+public:
+  AraBantHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraBantHeaderTestCase::AraBantHeaderTestCase ()
+  : TestCase ("Ara BANT header")
+{
+}
+
+void
+AraBantHeaderTestCase::DoRun (void)
+{
+  ara::BANTHeader plain (/*prefixSize=*/ 0, /*hopCount=*/ 2, Ipv4Address ("1.2.3.4"), /*dstSeqNo=*/ 7,
+                         Ipv4Address ("4.3.2.1"), Seconds (3));
+  NS_TEST_EXPECT_MSG_EQ (plain.GetSerializedSize (), 19, "No FANT ID field without a FANT ID");
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (plain);
+  ara::BANTHeader h;
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (h), 19, "Plain BANT deserialized");
+  NS_TEST_EXPECT_MSG_EQ ((h == plain), true, "Plain BANT round trip");
+  NS_TEST_EXPECT_MSG_EQ (h.GetFantId (), 0, "No FANT ID read");
+
+  ara::BANTHeader tagged = plain;
+  tagged.SetFantId (42);
+  NS_TEST_EXPECT_MSG_EQ (tagged.GetSerializedSize (), 23, "FANT ID field added");
+  p = Create<Packet> ();
+  p->AddHeader (tagged);
+  NS_TEST_EXPECT_MSG_EQ (p->RemoveHeader (h), 23, "Tagged BANT deserialized");
+  NS_TEST_EXPECT_MSG_EQ ((h == tagged), true, "Tagged BANT round trip");
+  NS_TEST_EXPECT_MSG_EQ (h.GetFantId (), 42, "FANT ID read back");
+
+  tagged.SetFantId (0);
+  NS_TEST_EXPECT_MSG_EQ (tagged.GetSerializedSize (), 19, "FANT ID field removed");
+  NS_TEST_EXPECT_MSG_EQ ((tagged == plain), true, "Flag cleared with the ID");
+}
+
+// Pheromone table of a routing table entry
+class AraPheromoneTableTestCase : public TestCase
+{
+public:
+  AraPheromoneTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraPheromoneTableTestCase::AraPheromoneTableTestCase ()
+  : TestCase ("Ara multipath pheromone table")
+{
+}
+
+void
+AraPheromoneTableTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                      /*lifetime=*/ Seconds (10));
+  NS_TEST_EXPECT_MSG_EQ (rt.GetNextHopCount (), 1, "Next hop of the constructor is recorded");
+  NS_TEST_EXPECT_MSG_EQ_TOL (rt.GetNextHopPheromone (Ipv4Address ("10.0.0.2")), 0.5, 1e-9, "Initial pheromone");
+
+  NS_TEST_EXPECT_MSG_EQ (rt.AddNextHop (Ipv4Address ("10.0.0.3"), 0, iface, 0.8, Seconds (5)), true, "New next hop");
+  NS_TEST_EXPECT_MSG_EQ (rt.AddNextHop (Ipv4Address ("10.0.0.3"), 0, iface, 0.9, Seconds (5)), false, "Existing next hop");
+  NS_TEST_EXPECT_MSG_EQ (rt.GetNextHopCount (), 2, "Two next hops");
+  NS_TEST_EXPECT_MSG_EQ_TOL (rt.GetNextHopPheromone (Ipv4Address ("10.0.0.3")), 0.9, 1e-9, "Pheromone updated");
+
+  NS_TEST_EXPECT_MSG_EQ (rt.SelectBestNextHop (), true, "Best next hop selected");
+  NS_TEST_EXPECT_MSG_EQ (rt.GetNextHop (), Ipv4Address ("10.0.0.3"), "Highest pheromone wins");
+  NS_TEST_EXPECT_MSG_EQ (rt.DeleteNextHop (Ipv4Address ("10.0.0.3")), true, "Next hop deleted");
+  NS_TEST_EXPECT_MSG_EQ (rt.DeleteNextHop (Ipv4Address ("10.0.0.3")), false, "Next hop already deleted");
+  NS_TEST_EXPECT_MSG_EQ (rt.GetNextHopCount (), 1, "One next hop left");
+}
+
+// Pheromone-proportional next hop selection
+class AraRouteSelectionTestCase : public TestCase
+{
+public:
+  AraRouteSelectionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraRouteSelectionTestCase::AraRouteSelectionTestCase ()
+  : TestCase ("Ara pheromone-proportional next hop selection")
+{
+}
+
+void
+AraRouteSelectionTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 4, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                      /*lifetime=*/ Seconds (10));
+  rt.AddNextHop (Ipv4Address ("10.0.0.3"), 0, iface, 0.75, Seconds (10));
+  // Cumulative pheromone is 0.25, 1.0
+  NS_TEST_EXPECT_MSG_EQ (rt.SelectRoute (0.0)->GetGateway (), Ipv4Address ("10.0.0.2"), "Lower end picks the first next hop");
+  NS_TEST_EXPECT_MSG_EQ (rt.SelectRoute (0.2)->GetGateway (), Ipv4Address ("10.0.0.2"), "Within the first share");
+  NS_TEST_EXPECT_MSG_EQ (rt.SelectRoute (0.3)->GetGateway (), Ipv4Address ("10.0.0.3"), "Within the second share");
+  NS_TEST_EXPECT_MSG_EQ (rt.SelectRoute (0.999)->GetGateway (), Ipv4Address ("10.0.0.3"), "Upper end picks the last next hop");
+  rt.DeleteNextHop (Ipv4Address ("10.0.0.3"));
+  NS_TEST_EXPECT_MSG_EQ (rt.SelectRoute (0.9)->GetGateway (), Ipv4Address ("10.0.0.2"), "Only one next hop left");
+}
+
+// Lazy pheromone evaporation
+class AraEvaporationTestCase : public TestCase
+{
+public:
+  AraEvaporationTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Check the evaporated pheromone two seconds after the records were set
+  void CheckEvaporation ();
+  /// Check that an exponential rate above 1 evaporates everything
+  void CheckFullEvaporation ();
+  /// Entry under test
+  ara::RoutingTableEntry m_rt;
+  /// Table whose settings change after its entry was added
+  ara::RoutingTable m_table;
+};
+
+AraEvaporationTestCase::AraEvaporationTestCase ()
+  : TestCase ("Ara lazy pheromone evaporation"),
+    m_table (Seconds (5))
+{
+}
+
+void
+AraEvaporationTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  m_rt = ara::RoutingTableEntry (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                 /*iface=*/ iface, /*hops=*/ 1, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                 /*lifetime=*/ Seconds (10));
+  m_rt.AddNextHop (Ipv4Address ("10.0.0.3"), 0, iface, 0.5, Seconds (10));
+  m_table.AddRoute (m_rt);
+  m_rt.SetEvaporation (ara::DECAY_LINEAR, 0.2);
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_rt.GetNextHopPheromone (Ipv4Address ("10.0.0.2")), 1.0, 1e-9, "Nothing evaporated yet");
+  m_table.SetPheromoneDecay (ara::DECAY_LINEAR);
+  m_table.SetEvaporationRate (0.2);
+  Simulator::Schedule (Seconds (2), &AraEvaporationTestCase::CheckEvaporation, this);
+  Simulator::Schedule (Seconds (3), &AraEvaporationTestCase::CheckFullEvaporation, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+AraEvaporationTestCase::CheckEvaporation ()
+{
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_rt.GetNextHopPheromone (Ipv4Address ("10.0.0.2")), 0.6, 1e-9, "Linear evaporation");
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_rt.GetNextHopPheromone (Ipv4Address ("10.0.0.3")), 0.1, 1e-9, "Linear evaporation");
+  // Weights are 0.6 and 0.1
+  NS_TEST_EXPECT_MSG_EQ (m_rt.SelectRoute (0.8)->GetGateway (), Ipv4Address ("10.0.0.2"), "Selection uses evaporated pheromone");
+  NS_TEST_EXPECT_MSG_EQ (m_rt.SelectRoute (0.9)->GetGateway (), Ipv4Address ("10.0.0.3"), "Selection uses evaporated pheromone");
+  m_rt.SetEvaporation (ara::DECAY_EXPONENTIAL, 0.5);
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_rt.GetNextHopPheromone (Ipv4Address ("10.0.0.2")), 0.6, 1e-9, "Switching curves keeps the value");
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_table.FindRoute (Ipv4Address ("10.0.0.9"))->GetNextHopPheromone (Ipv4Address ("10.0.0.2")),
+                             0.6, 1e-9, "Table settings reach the existing entry");
+  m_rt.SetEvaporation (ara::DECAY_EXPONENTIAL, 1.5);
+}
+
+void
+AraEvaporationTestCase::CheckFullEvaporation ()
+{
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_rt.GetNextHopPheromone (Ipv4Address ("10.0.0.2")), 0, 1e-9, "Rate above 1 evaporates everything");
+}
+
+// Routing table expiry index
+class AraExpiryIndexTestCase : public TestCase
+{
+public:
+  AraExpiryIndexTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Refresh the entry to 10.0.0.3 before its first deadline
+  void Refresh ();
+  /// Purge after the first deadlines have passed
+  void CheckInvalidated ();
+  /// Purge after the invalid entry has been deleted
+  void CheckDeleted ();
+  /// Table under test
+  ara::RoutingTable m_table;
+};
+
+AraExpiryIndexTestCase::AraExpiryIndexTestCase ()
+  : TestCase ("Ara routing table expiry index"),
+    m_table (/*badLinkLifetime=*/ Seconds (2))
+{
+}
+
+void
+AraExpiryIndexTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTableEntry rt1 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.2"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface, /*hops=*/ 1, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                       /*lifetime=*/ Seconds (1));
+  ara::RoutingTableEntry rt2 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.3"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface, /*hops=*/ 1, /*nextHop=*/ Ipv4Address ("10.0.0.3"),
+                                       /*lifetime=*/ Seconds (1));
+  ara::RoutingTableEntry rt3 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.4"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface, /*hops=*/ 1, /*nextHop=*/ Ipv4Address ("10.0.0.4"),
+                                       /*lifetime=*/ Seconds (10));
+  NS_TEST_EXPECT_MSG_EQ (m_table.AddRoute (rt1), true, "Route added");
+  NS_TEST_EXPECT_MSG_EQ (m_table.AddRoute (rt2), true, "Route added");
+  NS_TEST_EXPECT_MSG_EQ (m_table.AddRoute (rt3), true, "Route added");
+  Simulator::Schedule (Seconds (0.5), &AraExpiryIndexTestCase::Refresh, this);
+  Simulator::Schedule (Seconds (1.5), &AraExpiryIndexTestCase::CheckInvalidated, this);
+  Simulator::Schedule (Seconds (4), &AraExpiryIndexTestCase::CheckDeleted, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+AraExpiryIndexTestCase::Refresh ()
+{
+  ara::RoutingTableEntry rt;
+  NS_TEST_EXPECT_MSG_EQ (m_table.LookupRoute (Ipv4Address ("10.0.0.3"), rt), true, "Route found");
+  rt.SetLifeTime (Seconds (5));
+  NS_TEST_EXPECT_MSG_EQ (m_table.Update (rt), true, "Route updated");
+}
+
+void
+AraExpiryIndexTestCase::CheckInvalidated ()
+{
+  m_table.Purge ();
+  ara::RoutingTableEntry rt;
+  NS_TEST_EXPECT_MSG_EQ (m_table.LookupRoute (Ipv4Address ("10.0.0.2"), rt), true, "Expired route kept as invalid");
+  NS_TEST_EXPECT_MSG_EQ (rt.GetFlag (), ara::INVALID, "Expired route invalidated");
+  NS_TEST_EXPECT_MSG_EQ (m_table.LookupRoute (Ipv4Address ("10.0.0.3"), rt), true, "Refreshed route kept");
+  NS_TEST_EXPECT_MSG_EQ (rt.GetFlag (), ara::VALID, "Refreshed route still valid");
+}
+
+void
+AraExpiryIndexTestCase::CheckDeleted ()
+{
+  m_table.Purge ();
+  ara::RoutingTableEntry rt;
+  NS_TEST_EXPECT_MSG_EQ (m_table.LookupRoute (Ipv4Address ("10.0.0.2"), rt), false, "Invalid route deleted");
+  NS_TEST_EXPECT_MSG_EQ (m_table.LookupValidRoute (Ipv4Address ("10.0.0.3"), rt), true, "Refreshed route still valid");
+  NS_TEST_EXPECT_MSG_EQ (m_table.LookupValidRoute (Ipv4Address ("10.0.0.4"), rt), true, "Long-lived route still valid");
+}
+
+// Reverse index from next hops and interfaces to destinations
+class AraNextHopIndexTestCase : public TestCase
+{
+public:
+  AraNextHopIndexTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraNextHopIndexTestCase::AraNextHopIndexTestCase ()
+  : TestCase ("Ara routing table next hop index")
+{
+}
+
+void
+AraNextHopIndexTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface1 (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  Ipv4InterfaceAddress iface2 (Ipv4Address ("10.0.1.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTable table (Seconds (5));
+  ara::RoutingTableEntry rt1 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface1, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                       /*lifetime=*/ Seconds (10));
+  ara::RoutingTableEntry rt2 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.8"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface1, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                       /*lifetime=*/ Seconds (10));
+  ara::RoutingTableEntry rt3 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.1.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface2, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.1.2"),
+                                       /*lifetime=*/ Seconds (10));
+  table.AddRoute (rt1);
+  table.AddRoute (rt2);
+  table.AddRoute (rt3);
+
+  std::map<Ipv4Address, uint32_t> unreachable;
+  table.GetListOfDestinationWithNextHop (Ipv4Address ("10.0.0.2"), unreachable);
+  NS_TEST_EXPECT_MSG_EQ (unreachable.size (), 2, "Both destinations through 10.0.0.2");
+
+  rt2.SetNextHop (Ipv4Address ("10.0.0.3"));
+  table.Update (rt2);
+  table.GetListOfDestinationWithNextHop (Ipv4Address ("10.0.0.2"), unreachable);
+  NS_TEST_EXPECT_MSG_EQ (unreachable.size (), 1, "Next hop of 10.0.0.8 has changed");
+  NS_TEST_EXPECT_MSG_EQ (unreachable.count (Ipv4Address ("10.0.0.9")), 1, "10.0.0.9 still through 10.0.0.2");
+  table.GetListOfDestinationWithNextHop (Ipv4Address ("10.0.0.3"), unreachable);
+  NS_TEST_EXPECT_MSG_EQ (unreachable.size (), 1, "10.0.0.8 now through 10.0.0.3");
+
+  table.InvalidateRoutesWithDst (unreachable);
+  ara::RoutingTableEntry rt;
+  NS_TEST_EXPECT_MSG_EQ (table.LookupValidRoute (Ipv4Address ("10.0.0.8"), rt), false, "10.0.0.8 invalidated");
+  NS_TEST_EXPECT_MSG_EQ (table.LookupValidRoute (Ipv4Address ("10.0.0.9"), rt), true, "10.0.0.9 still valid");
+
+  table.DeleteAllRoutesFromInterface (iface1);
+  NS_TEST_EXPECT_MSG_EQ (table.LookupRoute (Ipv4Address ("10.0.0.9"), rt), false, "Routes of the interface deleted");
+  NS_TEST_EXPECT_MSG_EQ (table.LookupRoute (Ipv4Address ("10.0.1.9"), rt), true, "Routes of other interfaces kept");
+  table.GetListOfDestinationWithNextHop (Ipv4Address ("10.0.0.2"), unreachable);
+  NS_TEST_EXPECT_MSG_EQ (unreachable.size (), 0, "Deleted routes left the index");
+}
+
+// In-place routing table access
+class AraInPlaceAccessTestCase : public TestCase
+{
+public:
+  AraInPlaceAccessTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraInPlaceAccessTestCase::AraInPlaceAccessTestCase ()
+  : TestCase ("Ara in-place routing table access")
+{
+}
+
+void
+AraInPlaceAccessTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTable table (Seconds (5));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                      /*lifetime=*/ Seconds (1));
+  table.AddRoute (rt);
+  NS_TEST_EXPECT_MSG_EQ ((table.FindRoute (Ipv4Address ("10.0.0.8")) == 0), true, "No such route");
+  ara::RoutingTableEntry const * entry = table.FindValidRoute (Ipv4Address ("10.0.0.9"));
+  NS_TEST_EXPECT_MSG_EQ ((entry != 0), true, "Route found in place");
+  NS_TEST_EXPECT_MSG_EQ (entry->GetNextHop (), Ipv4Address ("10.0.0.2"), "Entry is the stored one");
+
+  NS_TEST_EXPECT_MSG_EQ (table.RefreshRoute (Ipv4Address ("10.0.0.9"), Seconds (3)), true, "Valid route refreshed");
+  NS_TEST_EXPECT_MSG_EQ (entry->GetLifeTime (), Seconds (3), "Lifetime extended in place");
+  NS_TEST_EXPECT_MSG_EQ (table.RefreshRoute (Ipv4Address ("10.0.0.9"), Seconds (2)), true, "Valid route refreshed");
+  NS_TEST_EXPECT_MSG_EQ (entry->GetLifeTime (), Seconds (3), "Lifetime never shortened");
+
+  table.SetEntryState (Ipv4Address ("10.0.0.9"), ara::INVALID);
+  NS_TEST_EXPECT_MSG_EQ ((table.FindValidRoute (Ipv4Address ("10.0.0.9")) == 0), true, "Route no longer valid");
+  NS_TEST_EXPECT_MSG_EQ (table.RefreshRoute (Ipv4Address ("10.0.0.9"), Seconds (3)), false, "Invalid routes are not refreshed");
+}
+
+// Node ID interning
+class AraNodeIdTestCase : public TestCase
+{
+public:
+  AraNodeIdTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraNodeIdTestCase::AraNodeIdTestCase ()
+  : TestCase ("Ara node ID interning")
+{
+}
+
+void
+AraNodeIdTestCase::DoRun (void)
+{
+  ara::NodeId first = ara::NodeIdMap::Intern (Ipv4Address ("10.0.0.1"));
+  ara::NodeId second = ara::NodeIdMap::Intern (Ipv4Address ("10.0.0.2"));
+  NS_TEST_EXPECT_MSG_EQ (second, first + 1, "IDs are dense");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::Intern (Ipv4Address ("10.0.0.1")), first, "IDs are stable");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::Lookup (Ipv4Address ("10.0.0.2")), second, "Lookup finds interned addresses");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::Lookup (Ipv4Address ("10.0.0.3")), ara::NodeIdMap::NONE, "Lookup does not intern");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::GetAddress (second), Ipv4Address ("10.0.0.2"), "Address of an ID");
+
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTable table (Seconds (5));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                      /*lifetime=*/ Seconds (10));
+  table.AddRoute (rt);
+  ara::NodeId dst = ara::NodeIdMap::Lookup (Ipv4Address ("10.0.0.9"));
+  NS_TEST_EXPECT_MSG_EQ ((table.FindRouteById (dst) != 0), true, "Destinations are interned by the table");
+  uint32_t size = ara::NodeIdMap::GetSize ();
+  NS_TEST_EXPECT_MSG_EQ ((table.FindRoute (Ipv4Address ("10.0.0.10")) == 0), true, "No route to an unknown address");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::GetSize (), size, "Lookups by address do not intern");
+  NS_TEST_EXPECT_MSG_EQ ((table.FindRouteById (ara::NodeIdMap::NONE) == 0), true, "NONE is a miss");
+
+  // IDs are reset with the simulation; the table reindexes its entries
+  uint32_t generation = ara::NodeIdMap::GetGeneration ();
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::GetGeneration (), generation + 1, "IDs reset by Simulator::Destroy");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::GetSize (), 0, "No IDs after reset");
+  NS_TEST_EXPECT_MSG_EQ ((table.FindRoute (Ipv4Address ("10.0.0.9")) != 0), true, "Entries survive the reset");
+  NS_TEST_EXPECT_MSG_EQ ((table.FindRouteById (ara::NodeIdMap::Lookup (Ipv4Address ("10.0.0.9"))) != 0), true,
+                         "Entries have new IDs");
+  Simulator::Destroy ();
+}
+
+// Precursor sets
+class AraPrecursorSetTestCase : public TestCase
+{
+public:
+  AraPrecursorSetTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraPrecursorSetTestCase::AraPrecursorSetTestCase ()
+  : TestCase ("Ara precursor sets")
+{
+}
+
+void
+AraPrecursorSetTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  ara::RoutingTableEntry first (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.1.1"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                         /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                         /*lifetime=*/ Seconds (10));
+  ara::RoutingTableEntry second = first;
+  NS_TEST_EXPECT_MSG_EQ (first.InsertPrecursor (Ipv4Address ("10.0.0.3")), true, "New precursor");
+  NS_TEST_EXPECT_MSG_EQ (first.InsertPrecursor (Ipv4Address ("10.0.0.3")), false, "Known precursor");
+  NS_TEST_EXPECT_MSG_EQ (first.LookupPrecursor (Ipv4Address ("10.0.0.3")), true, "Precursor found");
+  NS_TEST_EXPECT_MSG_EQ (first.LookupPrecursor (Ipv4Address ("10.0.0.4")), false, "Precursor not found");
+
+  // The second entry outgrows the inline array
+  for (uint32_t i = 3; i < 100; ++i)
+    {
+      second.InsertPrecursor (Ipv4Address (Ipv4Address ("10.0.0.0").Get () + i));
+    }
+  NS_TEST_EXPECT_MSG_EQ (second.DeletePrecursor (Ipv4Address ("10.0.0.50")), true, "Precursor deleted");
+  NS_TEST_EXPECT_MSG_EQ (second.DeletePrecursor (Ipv4Address ("10.0.0.50")), false, "Precursor already deleted");
+
+  ara::NodeIdSet precursors;
+  first.GetPrecursors (precursors);
+  second.GetPrecursors (precursors);
+  NS_TEST_EXPECT_MSG_EQ (precursors.GetSize (), 96, "Union of precursors");
+  std::vector<Ipv4Address> addresses (1, Ipv4Address ("10.0.0.3"));
+  addresses.push_back (Ipv4Address ("10.9.9.9"));
+  second.GetPrecursors (addresses);
+  NS_TEST_EXPECT_MSG_EQ (addresses.size (), 97, "Precursors are not duplicated");
+  NS_TEST_EXPECT_MSG_EQ (ara::NodeIdMap::Lookup (Ipv4Address ("10.9.9.9")), ara::NodeIdMap::NONE,
+                         "Addresses of the caller are not interned");
+
+  // Sets left over from an earlier simulation are empty
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ (second.IsPrecursorListEmpty (), true, "Precursors reset with node IDs");
+  NS_TEST_EXPECT_MSG_EQ (precursors.IsEmpty (), true, "Node ID sets reset with node IDs");
+}
+
+// Route cache of locally originated flows
+class AraRouteCacheTestCase : public TestCase
+{
+public:
+  AraRouteCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraRouteCacheTestCase::AraRouteCacheTestCase ()
+  : TestCase ("Ara route cache")
+{
+}
+
+void
+AraRouteCacheTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  Ipv4Address dst ("10.0.0.9");
+  ara::RoutingTable table (Seconds (5));
+  ara::RouteCache cache (/*size=*/ 8, /*refreshInterval=*/ Seconds (1));
+  table.SetRouteChangeCallback (MakeCallback (&ara::RouteCache::Invalidate, &cache));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ dst, /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ Ipv4Address ("10.0.0.2"),
+                                      /*lifetime=*/ Seconds (10));
+  table.AddRoute (rt);
+
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 1) == 0), true, "Empty cache misses");
+  cache.Insert (dst, 0, 1, rt.GetRoute (), Seconds (10));
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 1) == rt.GetRoute ()), true, "Cached route found");
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 2) == 0), true, "Other flows miss");
+
+  table.SetEntryState (dst, ara::INVALID);
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 1) == 0), true, "Route change drops the cached route");
+
+  cache.Insert (dst, 0, 1, rt.GetRoute (), Seconds (10));
+  table.Clear ();
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 1) == 0), true, "Clearing the table drops every cached route");
+
+  cache.Insert (dst, 0, 1, rt.GetRoute (), Seconds (10));
+  cache.Insert (dst, 0, 2, rt.GetRoute (), MilliSeconds (500));
+  Simulator::Stop (MilliSeconds (600));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 1) == rt.GetRoute ()), true, "Cached route used until its refresh");
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 2) == 0), true, "Route whose entry expired misses");
+  Simulator::Stop (MilliSeconds (500));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ ((cache.Lookup (dst, 0, 1) == 0), true, "Route due for a refresh misses");
+  Simulator::Destroy ();
+}
+
+// Route discovery buffer
+class AraRequestQueueTestCase : public TestCase
+{
+public:
+  AraRequestQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Count dropped packets
+   * \param p the packet
+   * \param header the IP header
+   * \param err the error
+   */
+  void Error (Ptr<const Packet> p, const Ipv4Header & header, Socket::SocketErrno err);
+  /**
+   * Forward a packet, doing nothing
+   * \param route the route
+   * \param p the packet
+   * \param header the IP header
+   */
+  void Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header & header);
+  /**
+   * Queue a new packet
+   * \param q the queue
+   * \param dst the destination
+   * \param size the packet size
+   * \returns the packet
+   */
+  Ptr<const Packet> Enqueue (ara::RequestQueue & q, Ipv4Address dst, uint32_t size = 100);
+  /// Number of dropped packets
+  uint32_t m_dropped;
+};
+
+AraRequestQueueTestCase::AraRequestQueueTestCase ()
+  : TestCase ("Ara route discovery buffer"),
+    m_dropped (0)
+{
+}
+
+void
+AraRequestQueueTestCase::Error (Ptr<const Packet> p, const Ipv4Header & header, Socket::SocketErrno err)
+{
+  ++m_dropped;
+}
+
+void
+AraRequestQueueTestCase::Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header & header)
+{
+}
+
+Ptr<const Packet>
+AraRequestQueueTestCase::Enqueue (ara::RequestQueue & q, Ipv4Address dst, uint32_t size)
+{
+  Ptr<const Packet> p = Create<Packet> (size);
+  Ipv4Header header;
+  header.SetDestination (dst);
+  ara::QueueEntry entry (p, header, ara::QueueEntry::UnicastForwardCallback (),
+                         MakeCallback (&AraRequestQueueTestCase::Error, this));
+  q.Enqueue (entry);
+  return p;
+}
+
+void
+AraRequestQueueTestCase::DoRun (void)
+{
+  Ipv4Address a ("10.0.0.1");
+  Ipv4Address b ("10.0.0.2");
+  ara::RequestQueue q (/*maxLen=*/ 4, /*routeToQueueTimeout=*/ Seconds (30));
+  Ptr<const Packet> a1 = Enqueue (q, a);
+  Enqueue (q, a);
+  Ptr<const Packet> b1 = Enqueue (q, b);
+  NS_TEST_EXPECT_MSG_EQ (q.GetSize (), 3, "Three packets queued");
+
+  ara::QueueEntry entry;
+  NS_TEST_EXPECT_MSG_EQ (q.Dequeue (a, entry), true, "Packet for a dequeued");
+  NS_TEST_EXPECT_MSG_EQ (entry.GetPacket (), a1, "Oldest packet for a first");
+  NS_TEST_EXPECT_MSG_EQ (q.Find (a), true, "Second packet for a still queued");
+
+  // Overflow drops the most aged packet of the largest backlog
+  Ptr<const Packet> b2 = Enqueue (q, b);
+  Enqueue (q, b);
+  Enqueue (q, b);
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, 1, "One packet dropped on overflow");
+  NS_TEST_EXPECT_MSG_EQ (q.Find (a), true, "Packet for a kept");
+
+  std::vector<ara::QueueEntry> entries;
+  NS_TEST_EXPECT_MSG_EQ (q.DequeueAll (b, entries), 3, "Whole backlog of b dequeued");
+  NS_TEST_EXPECT_MSG_EQ (entries.front ().GetPacket (), b2, "Backlog in queue order");
+  NS_TEST_EXPECT_MSG_EQ (q.GetSize (), 1, "Packet for a left");
+
+  Enqueue (q, a);
+  q.DropPacketWithDst (a);
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, 3, "Packets for a dropped");
+  NS_TEST_EXPECT_MSG_EQ (q.Find (a), false, "No packets for a");
+
+  // Shrinking the queue drops packets of the largest backlog
+  Enqueue (q, a);
+  Enqueue (q, b);
+  Enqueue (q, b);
+  q.SetMaxQueueLen (2);
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, 4, "One packet dropped");
+  NS_TEST_EXPECT_MSG_EQ (q.Find (a), true, "Packet for a kept");
+  Enqueue (q, b);
+  NS_TEST_EXPECT_MSG_EQ (q.GetSize (), 2, "Queue keeps its new length");
+
+  // Byte budget
+  ara::RequestQueue bytes (/*maxLen=*/ 10, /*routeToQueueTimeout=*/ Seconds (30), /*maxBytes=*/ 1000);
+  Enqueue (bytes, a, 600);
+  Enqueue (bytes, b, 300);
+  Enqueue (bytes, b, 300);
+  NS_TEST_EXPECT_MSG_EQ (bytes.GetBytes (), 600, "Largest backlog dropped to make room");
+  NS_TEST_EXPECT_MSG_EQ (bytes.Find (a), false, "Largest backlog was for a");
+  Enqueue (bytes, a, 2000);
+  NS_TEST_EXPECT_MSG_EQ (bytes.Find (a), false, "Packet larger than the queue dropped");
+  NS_TEST_EXPECT_MSG_EQ (bytes.GetSize (), 2, "Queued packets kept");
+
+  // Quota per destination
+  ara::RequestQueue quota (/*maxLen=*/ 10, /*routeToQueueTimeout=*/ Seconds (30), /*maxBytes=*/ 0,
+                           /*maxLenPerDst=*/ 2);
+  Enqueue (quota, a);
+  Enqueue (quota, a);
+  Enqueue (quota, a);
+  Enqueue (quota, b);
+  NS_TEST_EXPECT_MSG_EQ (quota.GetSize (), 3, "Destination held to its quota");
+
+  // Duplicates are packets with the same UID and destination
+  ara::RequestQueue q2 (/*maxLen=*/ 4, /*routeToQueueTimeout=*/ Seconds (30));
+  Ipv4Header header;
+  header.SetDestination (a);
+  ara::QueueEntry first (a1, header, ara::QueueEntry::UnicastForwardCallback (),
+                         MakeCallback (&AraRequestQueueTestCase::Error, this));
+  NS_TEST_EXPECT_MSG_EQ (q2.Enqueue (first), true, "Packet queued");
+  NS_TEST_EXPECT_MSG_EQ (q2.Enqueue (first), false, "Duplicate packet rejected");
+  header.SetDestination (b);
+  ara::QueueEntry second (a1, header, ara::QueueEntry::UnicastForwardCallback (),
+                          MakeCallback (&AraRequestQueueTestCase::Error, this));
+  NS_TEST_EXPECT_MSG_EQ (q2.Enqueue (second), true, "Same packet for another destination queued");
+  NS_TEST_EXPECT_MSG_EQ (q2.Dequeue (a, entry), true, "Packet dequeued");
+  NS_TEST_EXPECT_MSG_EQ (q2.Enqueue (first), true, "Dequeued packet can be queued again");
+
+  // Entries queued with a shorter timeout, as salvaged packets are, expire behind older entries
+  ara::RequestQueue q3 (/*maxLen=*/ 4, /*routeToQueueTimeout=*/ Seconds (30));
+  header.SetDestination (a);
+  ara::QueueEntry buffered (Create<Packet> (100), header, ara::QueueEntry::UnicastForwardCallback (),
+                            MakeCallback (&AraRequestQueueTestCase::Error, this));
+  q3.Enqueue (buffered);
+  ara::QueueEntry salvaged (Create<Packet> (100), header, ara::QueueEntry::UnicastForwardCallback (),
+                            MakeCallback (&AraRequestQueueTestCase::Error, this));
+  NS_TEST_EXPECT_MSG_EQ (q3.Enqueue (salvaged, Seconds (2)), true, "Salvaged packet queued");
+  // Raising the queue timeout does not hold the salvaged packet past its own timeout
+  q3.SetQueueTimeout (Seconds (60));
+  uint32_t dropped = m_dropped;
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (q3.GetSize (), 1, "Salvaged packet purged before the older packet");
+  NS_TEST_EXPECT_MSG_EQ (q3.GetBytes (), 100, "Its bytes released");
+  entries.clear ();
+  NS_TEST_EXPECT_MSG_EQ (q3.DequeueAll (a, entries), 1, "Only the packet within its timeout dequeued");
+  NS_TEST_EXPECT_MSG_EQ (entries.front ().GetPacket (), buffered.GetPacket (), "Packet with the queue timeout kept");
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, dropped + 1, "Salvaged packet dropped after its timeout");
+
+  // Packets with equal callbacks share one slot
+  Ipv4Address c ("10.0.0.3");
+  ara::RequestQueue pool (/*maxLen=*/ 4, /*routeToQueueTimeout=*/ Seconds (30));
+  Enqueue (pool, a);
+  Enqueue (pool, b);
+  NS_TEST_EXPECT_MSG_EQ (pool.GetCallbackSlots (), 1, "Equal callbacks share a slot");
+  NS_TEST_EXPECT_MSG_EQ (pool.GetCallbackSlotsInUse (), 1, "Shared slot in use");
+  ara::QueueEntry::UnicastForwardCallback forward = MakeCallback (&AraRequestQueueTestCase::Forward, this);
+  header.SetDestination (c);
+  ara::QueueEntry other (Create<Packet> (100), header, forward, ara::QueueEntry::ErrorCallback ());
+  pool.Enqueue (other);
+  NS_TEST_EXPECT_MSG_EQ (pool.GetCallbackSlots (), 2, "Other callbacks take another slot");
+  NS_TEST_EXPECT_MSG_EQ (pool.GetPoolSize (), 3, "One pooled entry per packet");
+  NS_TEST_EXPECT_MSG_EQ (pool.Dequeue (c, entry), true, "Packet with other callbacks dequeued");
+  NS_TEST_EXPECT_MSG_EQ (entry.GetUnicastForwardCallback ().IsEqual (forward), true, "Its callbacks restored");
+  NS_TEST_EXPECT_MSG_EQ (pool.GetCallbackSlotsInUse (), 1, "Slot released with its last packet");
+
+  // Free slots and entries are reused rather than grown
+  ara::QueueEntry third (Create<Packet> (100), header, forward,
+                         MakeCallback (&AraRequestQueueTestCase::Error, this));
+  pool.Enqueue (third);
+  NS_TEST_EXPECT_MSG_EQ (pool.GetCallbackSlots (), 2, "Unused slot reused");
+  NS_TEST_EXPECT_MSG_EQ (pool.GetCallbackSlotsInUse (), 2, "Reused slot in use");
+  NS_TEST_EXPECT_MSG_EQ (pool.GetPoolSize (), 3, "Free entry reused");
+  NS_TEST_EXPECT_MSG_EQ (pool.GetSize (), 3, "Three packets queued");
+  Simulator::Destroy ();
+}
+
+// Forwarded packets remembered per next hop
+class AraRetransmitBufferTestCase : public TestCase
+{
+public:
+  AraRetransmitBufferTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Remember a new packet
+   * \param buffer the buffer
+   * \param nextHop the next hop
+   * \returns the packet
+   */
+  Ptr<const Packet> Add (ara::RetransmitBuffer & buffer, Ipv4Address nextHop);
+};
+
+AraRetransmitBufferTestCase::AraRetransmitBufferTestCase ()
+  : TestCase ("Ara retransmit buffer")
+{
+}
+
+Ptr<const Packet>
+AraRetransmitBufferTestCase::Add (ara::RetransmitBuffer & buffer, Ipv4Address nextHop)
+{
+  Ptr<const Packet> p = Create<Packet> (100);
+  Ipv4Header header;
+  header.SetDestination (Ipv4Address ("10.0.0.9"));
+  ara::QueueEntry entry (p, header);
+  buffer.Add (nextHop, entry);
+  return p;
+}
+
+void
+AraRetransmitBufferTestCase::DoRun (void)
+{
+  Ipv4Address first ("10.0.0.2");
+  Ipv4Address second ("10.0.0.3");
+  ara::RetransmitBuffer buffer (2, Seconds (1));
+  Add (buffer, first);
+  Ptr<const Packet> older = Add (buffer, first);
+  Add (buffer, first);
+  NS_TEST_EXPECT_MSG_EQ (buffer.GetSize (), 2, "Oldest packet of the next hop forgotten");
+  Ptr<const Packet> other = Add (buffer, second);
+  NS_TEST_EXPECT_MSG_EQ (buffer.GetSize (), 3, "Next hops limited separately");
+
+  ara::QueueEntry entry;
+  NS_TEST_EXPECT_MSG_EQ (buffer.Remove (first, entry), true, "Packet found");
+  NS_TEST_EXPECT_MSG_EQ (entry.GetPacket (), older, "Oldest packet taken first");
+  std::vector<ara::QueueEntry> entries;
+  NS_TEST_EXPECT_MSG_EQ (buffer.RemoveAll (second, entries), 1, "All packets of the next hop taken");
+  NS_TEST_EXPECT_MSG_EQ (entries.front ().GetPacket (), other, "Packet of the next hop");
+  NS_TEST_EXPECT_MSG_EQ (buffer.Remove (second, entry), false, "No packet left for the next hop");
+  NS_TEST_EXPECT_MSG_EQ (buffer.GetSize (), 1, "Other next hop kept");
+
+  // Packets are forgotten silently after the timeout
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (buffer.Remove (first, entry), false, "Packet forgotten after the timeout");
+  NS_TEST_EXPECT_MSG_EQ (buffer.GetSize (), 0, "Buffer empty");
+
+  buffer.SetMaxLen (0);
+  Add (buffer, first);
+  NS_TEST_EXPECT_MSG_EQ (buffer.GetSize (), 0, "Disabled buffer");
+  Simulator::Destroy ();
+}
+
+// Duplicate detection cache
+class AraIdCacheTestCase : public TestCase
+{
+public:
+  AraIdCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Check IDs before they expire
+  void CheckKept ();
+  /// Check IDs after they expired
+  void CheckExpired ();
+  /// Cache under test
+  ara::IdCache m_cache;
+};
+
+AraIdCacheTestCase::AraIdCacheTestCase ()
+  : TestCase ("Ara duplicate detection cache"),
+    m_cache (/*lifetime=*/ Seconds (1))
+{
+}
+
+void
+AraIdCacheTestCase::DoRun (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 1), false, "New ID");
+  NS_TEST_EXPECT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 1), true, "Known ID");
+  NS_TEST_EXPECT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.2"), 1), false, "ID of another address");
+  Simulator::Schedule (Seconds (0.9), &AraIdCacheTestCase::CheckKept, this);
+  Simulator::Schedule (Seconds (2.5), &AraIdCacheTestCase::CheckExpired, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+AraIdCacheTestCase::CheckKept ()
+{
+  NS_TEST_EXPECT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 1), true, "ID kept for its lifetime");
+  NS_TEST_EXPECT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 2), false, "New ID in a later bucket");
+  NS_TEST_EXPECT_MSG_EQ (m_cache.GetSize (), 3, "Three IDs cached");
+}
+
+void
+AraIdCacheTestCase::CheckExpired ()
+{
+  NS_TEST_EXPECT_MSG_EQ (m_cache.GetSize (), 0, "All IDs expired");
+  NS_TEST_EXPECT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 1), false, "Expired ID is new again");
+}
+
+// Sliding window of FANT IDs
+class AraIdWindowTestCase : public TestCase
+{
+public:
+  AraIdWindowTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraIdWindowTestCase::AraIdWindowTestCase ()
+  : TestCase ("Ara duplicate detection window")
+{
+}
+
+void
+AraIdWindowTestCase::DoRun (void)
+{
+  Ipv4Address origin ("10.0.0.1");
+  ara::IdCache cache (/*lifetime=*/ Seconds (1), ara::ID_CACHE_WINDOW);
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 10), false, "First ID");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 12), false, "Higher ID");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 11), false, "ID seen out of order");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 11), true, "Known ID");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 10), true, "Known ID below the highest");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 100), false, "ID in the next word");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 12), true, "Known ID shifted by a word");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 50), false, "Unseen ID in the window");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 1000), false, "ID far ahead");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 100), true, "IDs below the window count as seen");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (Ipv4Address ("10.0.0.2"), 100), false, "Windows are per origin");
+  NS_TEST_EXPECT_MSG_EQ (cache.GetSize (), 2, "One window per origin");
+  NS_TEST_EXPECT_MSG_EQ (cache.IsDuplicate (origin, 0xffffffff), true, "ID far below");
+}
+
+// Previous hops of FANTs for multipath route discovery
+class AraFantPathCacheTestCase : public TestCase
+{
+public:
+  AraFantPathCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraFantPathCacheTestCase::AraFantPathCacheTestCase ()
+  : TestCase ("Ara FANT path cache")
+{
+}
+
+void
+AraFantPathCacheTestCase::DoRun (void)
+{
+  Ipv4Address origin ("10.0.0.1");
+  Ipv4Address a ("10.0.0.2");
+  Ipv4Address b ("10.0.0.3");
+  Ipv4Address c ("10.0.0.4");
+  Ipv4Address d ("10.0.0.5");
+  ara::FantPathCache cache (/*lifetime=*/ Seconds (1));
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, a, 3, 3), false, "Unknown FANT");
+  cache.AddFirst (origin, 7, a, 3);
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, a, 3, 3), false, "Same previous hop");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, b, 5, 3), false, "Copy relayed through this node");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, b, 4, 3), false, "One hop longer");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 8, c, 3, 3), false, "Other FANT");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, b, 3, 3), true, "As long");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, c, 2, 3), true, "Shorter");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, d, 3, 3), false, "Longer than the shortest copy");
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, d, 2, 3), false, "Path limit");
+  NS_TEST_EXPECT_MSG_EQ (cache.GetSize (), 1, "One FANT");
+
+  // BANTs answering the FANT are relayed over its previous hops in turn
+  Ipv4Address prevHop;
+  NS_TEST_EXPECT_MSG_EQ (cache.NextReverseHop (origin, 8, prevHop), false, "No reverse path of another FANT");
+  cache.NextReverseHop (origin, 7, prevHop);
+  NS_TEST_EXPECT_MSG_EQ (prevHop, a, "First BANT over the previous hop of the first copy");
+  cache.NextReverseHop (origin, 7, prevHop);
+  NS_TEST_EXPECT_MSG_EQ (prevHop, b, "Second BANT over the first alternative");
+  cache.NextReverseHop (origin, 7, prevHop);
+  NS_TEST_EXPECT_MSG_EQ (prevHop, c, "Third BANT over the second alternative");
+  cache.NextReverseHop (origin, 7, prevHop);
+  NS_TEST_EXPECT_MSG_EQ (prevHop, a, "Previous hops taken in turn");
+
+  // Neighbors x and y are both two hops from the origin and hear each other's rebroadcast
+  Ipv4Address x ("10.0.0.6");
+  Ipv4Address y ("10.0.0.7");
+  ara::FantPathCache atX (/*lifetime=*/ Seconds (1));
+  ara::FantPathCache atY (/*lifetime=*/ Seconds (1));
+  atX.AddFirst (origin, 9, a, 2);
+  atY.AddFirst (origin, 9, b, 2);
+  NS_TEST_EXPECT_MSG_EQ (atX.AddAlternative (origin, 9, y, 3, 3), false, "x does not route back through y");
+  NS_TEST_EXPECT_MSG_EQ (atY.AddAlternative (origin, 9, x, 3, 3), false, "y does not route back through x");
+
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (cache.AddAlternative (origin, 7, d, 3, 4), false, "Expired");
+  NS_TEST_EXPECT_MSG_EQ (cache.GetSize (), 0, "Record removed");
+
+  // Records added after the lifetime is lowered expire in order with the older ones
+  cache.SetLifetime (Seconds (10));
+  cache.AddFirst (origin, 10, a, 2);
+  cache.SetLifetime (Seconds (1));
+  cache.AddFirst (origin, 11, a, 2);
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (cache.GetSize (), 2, "Newer record kept until the older one expires");
+  Simulator::Stop (Seconds (9));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (cache.GetSize (), 0, "Both records removed");
+  Simulator::Destroy ();
+}
+
+// Bloom filter duplicate packet detection
+class AraBloomDpdTestCase : public TestCase
+{
+public:
+  AraBloomDpdTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraBloomDpdTestCase::AraBloomDpdTestCase ()
+  : TestCase ("Ara Bloom filter duplicate detection")
+{
+}
+
+void
+AraBloomDpdTestCase::DoRun (void)
+{
+  ara::DuplicatePacketDetection dpd (/*lifetime=*/ Seconds (10));
+  dpd.SetBloomFilter (/*packets=*/ 1000, /*falsePositiveRate=*/ 0.01);
+  dpd.SetMode (ara::DPD_BLOOM);
+  // Each filter is sized for half the rate: 1000 keys at 0.5% need 11028 bits, rounded up to 173 words
+  NS_TEST_EXPECT_MSG_EQ (dpd.GetMemoryUsage (), 2768, "Filters sized for the capacity and rate");
+
+  Ipv4Header header;
+  header.SetSource (Ipv4Address ("10.0.0.1"));
+  std::vector<Ptr<const Packet> > packets;
+  uint32_t falsePositives = 0;
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      packets.push_back (Create<Packet> ());
+      if (dpd.IsDuplicate (packets.back (), header))
+        {
+          ++falsePositives;
+        }
+    }
+  NS_TEST_EXPECT_MSG_LT (falsePositives, 50, "Few new packets reported as duplicates");
+  NS_TEST_EXPECT_MSG_LT (dpd.GetFalsePositiveRate (), 0.05, "Estimated false positive rate near the target");
+  NS_TEST_EXPECT_MSG_EQ (dpd.GetEarlyRotations (), 0, "No rotation within the capacity");
+  bool allDuplicates = true;
+  for (uint32_t i = 0; i < packets.size (); ++i)
+    {
+      allDuplicates = allDuplicates && dpd.IsDuplicate (packets[i], header);
+    }
+  NS_TEST_EXPECT_MSG_EQ (allDuplicates, true, "No false negatives");
+  NS_TEST_EXPECT_MSG_EQ (dpd.GetDuplicates (), 1000 + falsePositives, "Duplicates counted");
+
+  // The full filter is rotated out once; filling the other one puts both near capacity
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      dpd.IsDuplicate (Create<Packet> (), header);
+    }
+  NS_TEST_EXPECT_MSG_LT (dpd.GetFalsePositiveRate (), 0.012, "Both filters within the configured rate");
+  NS_TEST_EXPECT_MSG_EQ (dpd.GetEarlyRotations (), 1, "Full filter rotated out early");
+}
+
+// Neighbor table
+class AraNeighborsTestCase : public TestCase
+{
+public:
+  AraNeighborsTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Record a link failure
+   * \param addr the neighbor address
+   */
+  void LinkFailure (Ipv4Address addr);
+  /// Addresses of the failed links, in order
+  std::vector<Ipv4Address> m_failures;
+};
+
+AraNeighborsTestCase::AraNeighborsTestCase ()
+  : TestCase ("Ara neighbor table")
+{
+}
+
+void
+AraNeighborsTestCase::LinkFailure (Ipv4Address addr)
+{
+  m_failures.push_back (addr);
+}
+
+void
+AraNeighborsTestCase::DoRun (void)
+{
+  Ipv4Address a ("10.0.0.1");
+  Ipv4Address b ("10.0.0.2");
+  ara::Neighbors nb (/*delay=*/ Seconds (1));
+  nb.SetCallback (MakeCallback (&AraNeighborsTestCase::LinkFailure, this));
+  nb.Update (a, Seconds (2));
+  nb.Update (a, b, Seconds (0.5));
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (a), true, "Neighbor a");
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (b), true, "Neighbor b");
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (Ipv4Address ("10.0.0.3")), false, "Unknown address");
+  NS_TEST_EXPECT_MSG_EQ (nb.GetExpireTime (a), Seconds (2), "Expire time is never shortened");
+  NS_TEST_EXPECT_MSG_EQ (nb.GetTimerEvents (), 2, "Timer re-armed for the earlier deadline of b");
+  nb.Update (a, Seconds (2));
+  NS_TEST_EXPECT_MSG_EQ (nb.GetTimerEvents (), 2, "Refreshing a neighbor does not re-arm the timer");
+
+  Simulator::Stop (Seconds (5));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (a), false, "Neighbor a expired");
+  NS_TEST_EXPECT_MSG_EQ (m_failures.size (), 2, "Both links failed");
+  if (m_failures.size () == 2)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_failures[0], b, "Link to b failed first");
+      NS_TEST_EXPECT_MSG_EQ (m_failures[1], a, "Link to a failed last");
+    }
+  Simulator::Destroy ();
+}
+
+// Neighbor expiry timer events generated by periodic hello messages
+class AraNeighborTimerBenchmarkTestCase : public TestCase
+{
+public:
+  AraNeighborTimerBenchmarkTestCase ();
+
+private:
+  /**
+   * Neighbor expiry as it was before the timer followed the earliest
+   * deadline: a periodic purge, rescheduled on every purge and every new neighbor
+   */
+  class PeriodicPurge
+  {
+  public:
+    /**
+     * constructor
+     * \param delay the purge period
+     */
+    PeriodicPurge (Time delay);
+    /**
+     * Update the expire time of a neighbor as Neighbors::Update did
+     * \param addr the neighbor address
+     * \param expire the expire time
+     */
+    void Update (Ipv4Address addr, Time expire);
+    /// Start the purge timer, as the routing protocol does
+    void ScheduleTimer ();
+    /// Remove expired neighbors and reschedule the timer
+    void Purge ();
+    /// Expire time of each neighbor
+    std::map<Ipv4Address, Time> m_expire;
+    /// Purge timer
+    Timer m_ntimer;
+    /// Number of times the timer was scheduled
+    uint32_t m_timerEvents;
+  };
+  virtual void DoRun (void);
+  /**
+   * Receive a hello from a neighbor and schedule the next one
+   * \param nb the neighbor table
+   * \param periodic the neighbor table with periodic purge
+   * \param addr the neighbor address
+   * \param interval the hello interval
+   */
+  static void RecvHello (ara::Neighbors * nb, PeriodicPurge * periodic, Ipv4Address addr, Time interval);
+};
+
+AraNeighborTimerBenchmarkTestCase::PeriodicPurge::PeriodicPurge (Time delay)
+  : m_ntimer (Timer::CANCEL_ON_DESTROY),
+    m_timerEvents (0)
+{
+  m_ntimer.SetDelay (delay);
+  m_ntimer.SetFunction (&PeriodicPurge::Purge, this);
+}
+
+void
+AraNeighborTimerBenchmarkTestCase::PeriodicPurge::Update (Ipv4Address addr, Time expire)
+{
+  std::map<Ipv4Address, Time>::iterator i = m_expire.find (addr);
+  if (i != m_expire.end ())
+    {
+      i->second = std::max (expire + Simulator::Now (), i->second);
+      return;
+    }
+  m_expire[addr] = expire + Simulator::Now ();
+  Purge ();
+}
+
+void
+AraNeighborTimerBenchmarkTestCase::PeriodicPurge::ScheduleTimer ()
+{
+  m_ntimer.Cancel ();
+  m_ntimer.Schedule ();
+  ++m_timerEvents;
+}
+
+void
+AraNeighborTimerBenchmarkTestCase::PeriodicPurge::Purge ()
+{
+  if (m_expire.empty ())
+    {
+      return;
+    }
+  for (std::map<Ipv4Address, Time>::iterator i = m_expire.begin (); i != m_expire.end (); )
+    {
+      if (i->second < Simulator::Now ())
+        {
+          m_expire.erase (i++);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+  ScheduleTimer ();
+}
+
+AraNeighborTimerBenchmarkTestCase::AraNeighborTimerBenchmarkTestCase ()
+  : TestCase ("Ara neighbor expiry timer benchmark")
+{
+}
+
+void
+AraNeighborTimerBenchmarkTestCase::RecvHello (ara::Neighbors * nb, PeriodicPurge * periodic,
+                                              Ipv4Address addr, Time interval)
+{
+  // Neighbors expire after two lost hellos, as with the default AllowedHelloLoss
+  nb->Update (addr, 2 * interval);
+  periodic->Update (addr, 2 * interval);
+  Simulator::Schedule (interval, &AraNeighborTimerBenchmarkTestCase::RecvHello, nb, periodic, addr, interval);
+}
+
+void
+AraNeighborTimerBenchmarkTestCase::DoRun (void)
+{
+  const uint32_t neighbors = 20;
+  const Time interval = Seconds (1);
+  const double duration = 100;
+  ara::Neighbors nb (interval);
+  PeriodicPurge periodic (interval);
+  nb.ScheduleTimer ();
+  periodic.ScheduleTimer ();
+  for (uint32_t n = 0; n < neighbors; ++n)
+    {
+      // Spread the hellos of the neighbors over the interval
+      Simulator::Schedule (interval * n / neighbors, &AraNeighborTimerBenchmarkTestCase::RecvHello,
+                           &nb, &periodic, Ipv4Address ((10 << 24) + n + 2), interval);
+    }
+  Simulator::Stop (Seconds (duration));
+  Simulator::Run ();
+
+  std::cout << "Neighbor expiry timer events per second with " << neighbors << " neighbors: "
+            << periodic.m_timerEvents / duration << " with periodic purge, "
+            << nb.GetTimerEvents () / duration << " following the earliest deadline" << std::endl;
+
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (Ipv4Address ((10 << 24) + 2)), true, "Neighbors kept alive by hellos");
+  NS_TEST_EXPECT_MSG_EQ (periodic.m_expire.size (), neighbors, "Same neighbors kept by the periodic purge");
+  NS_TEST_EXPECT_MSG_LT (nb.GetTimerEvents (), duration / interval.GetSeconds (),
+                         "At most one timer event per purge interval");
+  NS_TEST_EXPECT_MSG_LT (nb.GetTimerEvents (), periodic.m_timerEvents, "Fewer timer events than the periodic purge");
+  Simulator::Destroy ();
+}
+
+// Link delivery ratio scaling of the pheromone
+class AraLinkQualityTestCase : public TestCase
+{
+public:
+  AraLinkQualityTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraLinkQualityTestCase::AraLinkQualityTestCase ()
+  : TestCase ("Ara link quality")
+{
+}
+
+void
+AraLinkQualityTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  Ipv4Address lossy ("10.0.0.2");
+  Ipv4Address clean ("10.0.0.3");
+  ara::RoutingTable table (Seconds (5));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.9"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ lossy,
+                                      /*lifetime=*/ Seconds (10));
+  rt.AddNextHop (clean, 0, iface, 0.4, Seconds (10));
+  table.AddRoute (rt);
+
+  table.SetLinkQuality (lossy, 0.5);
+  ara::RoutingTableEntry const * entry = table.FindRoute (Ipv4Address ("10.0.0.9"));
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (lossy), 0.25, 1e-9, "Pheromone scaled by the delivery ratio");
+  NS_TEST_EXPECT_MSG_EQ (entry->GetNextHop (), clean, "Switched away from the lossy link");
+
+  ara::RoutingTableEntry rt2 (/*dev=*/ 0, /*dst=*/ Ipv4Address ("10.0.0.8"), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface, /*hops=*/ 1, /*nextHop=*/ lossy,
+                                       /*lifetime=*/ Seconds (10));
+  table.AddRoute (rt2);
+  NS_TEST_EXPECT_MSG_EQ_TOL (table.FindRoute (Ipv4Address ("10.0.0.8"))->GetNextHopPheromone (lossy), 0.5, 1e-9,
+                             "Delivery ratio applies to routes added later");
+
+  table.SetLinkQuality (lossy, 1);
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (lossy), 0.5, 1e-9, "Link recovered");
+  NS_TEST_EXPECT_MSG_EQ (entry->GetNextHop (), lossy, "Switched back to the stronger next hop");
+
+  ara::Neighbors nb (Seconds (1));
+  NS_TEST_EXPECT_MSG_EQ (nb.GetLinkQuality (lossy), 1, "No feedback yet");
+}
+
+// Link delivery ratio estimate of the neighbor table
+class AraLinkQualityEstimateTestCase : public TestCase
+{
+public:
+  AraLinkQualityEstimateTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Record a reported delivery ratio
+   * \param addr the neighbor address
+   * \param quality the delivery ratio
+   */
+  void LinkQuality (Ipv4Address addr, double quality);
+  /**
+   * Count a reported frame outcome
+   * \param addr the neighbor address
+   * \param delivered whether the frame was delivered
+   */
+  void TxStatus (Ipv4Address addr, bool delivered);
+  /// Reported delivery ratios, in order
+  std::vector<double> m_reports;
+  /// Number of frames reported delivered
+  uint32_t m_delivered;
+  /// Number of frames reported dropped
+  uint32_t m_dropped;
+};
+
+AraLinkQualityEstimateTestCase::AraLinkQualityEstimateTestCase ()
+  : TestCase ("Ara link quality estimate"),
+    m_delivered (0),
+    m_dropped (0)
+{
+}
+
+void
+AraLinkQualityEstimateTestCase::LinkQuality (Ipv4Address addr, double quality)
+{
+  m_reports.push_back (quality);
+}
+
+void
+AraLinkQualityEstimateTestCase::TxStatus (Ipv4Address addr, bool delivered)
+{
+  if (delivered)
+    {
+      ++m_delivered;
+    }
+  else
+    {
+      ++m_dropped;
+    }
+}
+
+void
+AraLinkQualityEstimateTestCase::DoRun (void)
+{
+  Ipv4Address addr ("10.0.0.2");
+  Mac48Address mac ("00:00:00:00:00:02");
+  Ptr<ArpCache> arp = CreateObject<ArpCache> ();
+  arp->Add (addr)->MarkAlive (mac);
+  ara::Neighbors nb (Seconds (1));
+  nb.AddArpCache (arp);
+  nb.SetLinkQualityWeight (0.5);
+  nb.SetLinkQualityCallback (MakeCallback (&AraLinkQualityEstimateTestCase::LinkQuality, this));
+  nb.SetTxStatusCallback (MakeCallback (&AraLinkQualityEstimateTestCase::TxStatus, this));
+  nb.Update (addr, Seconds (10));
+
+  WifiMacHeader hdr;
+  hdr.SetAddr1 (mac);
+  hdr.SetNoRetry ();
+  nb.GetTxOkCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 1, 1e-9, "Delivered at the first attempt");
+  NS_TEST_EXPECT_MSG_EQ (m_reports.size (), 0, "Nothing to report");
+  NS_TEST_EXPECT_MSG_EQ (m_delivered, 1, "Delivered frame reported");
+
+  // A retry counts as one failed attempt followed by a delivered one
+  nb.GetTxDataFailedCallback () (mac);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 0.5, 1e-9, "Failed attempt");
+  nb.GetTxOkCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 0.75, 1e-9, "Failed then delivered");
+  NS_TEST_EXPECT_MSG_EQ (m_reports.size (), 2, "Changes reported");
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_reports.back (), 0.75, 1e-9, "Estimate reported");
+
+  nb.SetLinkQualityWeight (0.02);
+  nb.GetTxOkCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 0.755, 1e-9, "Small step");
+  NS_TEST_EXPECT_MSG_EQ (m_reports.size (), 2, "Change below the report step not reported");
+
+  nb.SetLinkQualityWeight (0);
+  nb.GetTxDataFailedCallback () (mac);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 0.755, 1e-9, "Estimate disabled");
+
+  // A dropped frame is a failed attempt; the link breaks below the threshold
+  nb.SetLinkQualityWeight (0.5);
+  nb.SetMaxTxErrors (3);
+  nb.SetLinkQualityThreshold (0.2);
+  nb.GetTxErrorCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 0.3775, 1e-9, "Dropped frame counted as a failure");
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (addr), true, "One dropped frame does not break the link");
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, 1, "Dropped frame reported");
+  nb.GetTxOkCallback () (hdr);
+  nb.GetTxErrorCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 0.344375, 1e-9, "Estimate above the threshold");
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (addr), true, "Link kept above the threshold");
+  nb.GetTxErrorCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (addr), false, "Link closed below the threshold");
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, 2, "Frame that closes the link reported as a link failure only");
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_reports.back (), 1, 1e-9, "Estimate reset on close");
+  NS_TEST_EXPECT_MSG_EQ_TOL (nb.GetLinkQuality (addr), 1, 1e-9, "No estimate without the neighbor");
+
+  // Without an estimate the link breaks after MaxTxErrors dropped frames in a row
+  nb.SetLinkQualityWeight (0);
+  nb.Update (addr, Seconds (10));
+  nb.GetTxErrorCallback () (hdr);
+  nb.GetTxErrorCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (addr), true, "Two dropped frames tolerated");
+  nb.GetTxOkCallback () (hdr);
+  nb.GetTxErrorCallback () (hdr);
+  nb.GetTxErrorCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (addr), true, "Delivered frame resets the count");
+  nb.GetTxErrorCallback () (hdr);
+  NS_TEST_EXPECT_MSG_EQ (nb.IsNeighbor (addr), false, "Link closed after MaxTxErrors dropped frames in a row");
+  Simulator::Destroy ();
+}
+
+// Pheromone reinforcement by data traffic
+class AraReinforcementTestCase : public TestCase
+{
+public:
+  AraReinforcementTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraReinforcementTestCase::AraReinforcementTestCase ()
+  : TestCase ("Ara pheromone reinforcement")
+{
+}
+
+void
+AraReinforcementTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  Ipv4Address dst ("10.0.0.9");
+  Ipv4Address used ("10.0.0.2");
+  Ipv4Address idle ("10.0.0.3");
+  ara::RoutingTable table (Seconds (5));
+  table.SetPheromoneDeposit (0.1);
+  table.SetReinforcementInterval (MilliSeconds (100));
+  ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ dst, /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                      /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ used,
+                                      /*lifetime=*/ Seconds (10));
+  rt.AddNextHop (idle, 0, iface, 0.5, Seconds (10));
+  table.AddRoute (rt);
+
+  for (uint32_t k = 0; k < 10; ++k)
+    {
+      table.RefreshRoute (dst, Seconds (3), used);
+    }
+  ara::RoutingTableEntry const * entry = table.FindRoute (dst);
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (used), 0.6, 1e-9, "Burst coalesced into one deposit");
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (idle), 0.5, 1e-9, "Idle next hop not reinforced");
+
+  Simulator::Stop (MilliSeconds (150));
+  Simulator::Run ();
+  table.RefreshRoute (dst, Seconds (3));
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (used), 0.6, 1e-9, "Plain refresh not reinforced");
+  table.RefreshRoute (dst, Seconds (3), used);
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (used), 0.7, 1e-9, "Deposit in the next interval");
+
+  table.SetPheromoneDeposit (0);
+  Simulator::Stop (MilliSeconds (150));
+  Simulator::Run ();
+  table.RefreshRoute (dst, Seconds (3), used);
+  NS_TEST_EXPECT_MSG_EQ_TOL (entry->GetNextHopPheromone (used), 0.7, 1e-9, "Reinforcement disabled");
+  Simulator::Destroy ();
+}
+
+// Local failover to an alternate next hop on link break
+class AraFailOverTestCase : public TestCase
+{
+public:
+  AraFailOverTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AraFailOverTestCase::AraFailOverTestCase ()
+  : TestCase ("Ara local failover")
+{
+}
+
+void
+AraFailOverTestCase::DoRun (void)
+{
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0"));
+  Ipv4Address broken ("10.0.0.2");
+  Ipv4Address backup ("10.0.0.3");
+  Ipv4Address multi ("10.0.0.7");
+  Ipv4Address single ("10.0.0.8");
+  Ipv4Address spare ("10.0.0.9");
+  ara::RoutingTable table (Seconds (5));
+  ara::RoutingTableEntry rt1 (/*dev=*/ 0, /*dst=*/ multi, /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                       /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ broken,
+                                       /*lifetime=*/ Seconds (10));
+  rt1.AddNextHop (backup, 0, iface, 0.5, Seconds (10));
+  table.AddRoute (rt1);
+  ara::RoutingTableEntry rt2 (/*dev=*/ 0, /*dst=*/ single, /*vSeqNo=*/ true, /*seqNo=*/ 4,
+                                       /*iface=*/ iface, /*hops=*/ 3, /*nextHop=*/ broken,
+                                       /*lifetime=*/ Seconds (10));
+  table.AddRoute (rt2);
+  ara::RoutingTableEntry rt3 (/*dev=*/ 0, /*dst=*/ spare, /*vSeqNo=*/ true, /*seqNo=*/ 2,
+                                       /*iface=*/ iface, /*hops=*/ 2, /*nextHop=*/ backup,
+                                       /*lifetime=*/ Seconds (10));
+  rt3.AddNextHop (broken, 0, iface, 0.5, Seconds (10));
+  table.AddRoute (rt3);
+
+  std::map<Ipv4Address, uint32_t> unreachable;
+  std::vector<Ipv4Address> switched;
+  table.FailOverNextHop (broken, unreachable, switched);
+  NS_TEST_EXPECT_MSG_EQ (switched.size (), 1, "One route switched");
+  NS_TEST_EXPECT_MSG_EQ (switched.front (), multi, "Route with a backup switched");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (multi)->GetNextHop (), backup, "Backup next hop selected");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (multi)->HasNextHop (broken), false, "Broken next hop removed");
+  NS_TEST_EXPECT_MSG_EQ (unreachable.size (), 1, "One route unreachable");
+  NS_TEST_EXPECT_MSG_EQ (unreachable[single], 4, "Route without a backup reported");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (spare)->GetNextHop (), backup, "Current next hop kept");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (spare)->HasNextHop (broken), false, "Broken alternative removed");
+
+  std::map<Ipv4Address, uint32_t> affected;
+  table.GetListOfDestinationWithNextHop (broken, affected);
+  NS_TEST_EXPECT_MSG_EQ (affected.size (), 1, "Only the unreachable route still uses the broken next hop");
+  Simulator::Destroy ();
+}
+
+// Packet salvaging at an intermediate node
+class AraSalvageTestCase : public TestCase
+{
+public:
+  AraSalvageTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Hand packets of another node to the routing protocol of an intermediate node
+   * \param protocol the routing protocol
+   * \param idev the device the packets arrive on
+   */
+  void Receive (Ptr<ara::RoutingProtocol> protocol, Ptr<NetDevice> idev);
+  /**
+   * Record a forwarded packet
+   * \param route the route
+   * \param p the packet
+   * \param header the IP header
+   */
+  void Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header & header);
+  /**
+   * Count dropped packets
+   * \param p the packet
+   * \param header the IP header
+   * \param err the error
+   */
+  void Error (Ptr<const Packet> p, const Ipv4Header & header, Socket::SocketErrno err);
+  /// Source of the packets
+  Ipv4Address m_source;
+  /// Reachable destination, unknown to the intermediate node
+  Ipv4Address m_dst;
+  /// Destination that does not exist
+  Ipv4Address m_unreachable;
+  /// Packet to the reachable destination
+  Ptr<const Packet> m_held;
+  /// TTL of the packets
+  uint8_t m_ttl;
+  /// Whether the packet to the reachable destination was accepted
+  bool m_heldAccepted;
+  /// Whether the packet to the unreachable destination was accepted
+  bool m_lostAccepted;
+  /// Whether the packet larger than the buffer was accepted
+  bool m_oversizedAccepted;
+  /// Number of packets dropped when the packet larger than the buffer was refused
+  uint32_t m_droppedOnOversized;
+  /// Next hops of the forwarded packets
+  std::vector<Ipv4Address> m_gateways;
+  /// Forwarded packets
+  std::vector<Ptr<const Packet> > m_packets;
+  /// IP headers of the forwarded packets
+  std::vector<Ipv4Header> m_headers;
+  /// Number of dropped packets
+  uint32_t m_dropped;
+};
+
+AraSalvageTestCase::AraSalvageTestCase ()
+  : TestCase ("Ara packet salvaging"),
+    m_ttl (20),
+    m_heldAccepted (false),
+    m_lostAccepted (false),
+    m_oversizedAccepted (true),
+    m_droppedOnOversized (0),
+    m_dropped (0)
+{
+}
+
+void
+AraSalvageTestCase::Receive (Ptr<ara::RoutingProtocol> protocol, Ptr<NetDevice> idev)
+{
+  Ipv4Header header;
+  header.SetSource (m_source);
+  header.SetDestination (m_dst);
+  header.SetTtl (m_ttl);
+  Ipv4RoutingProtocol::UnicastForwardCallback ucb = MakeCallback (&AraSalvageTestCase::Forward, this);
+  Ipv4RoutingProtocol::MulticastForwardCallback mcb;
+  Ipv4RoutingProtocol::LocalDeliverCallback lcb;
+  Ipv4RoutingProtocol::ErrorCallback ecb = MakeCallback (&AraSalvageTestCase::Error, this);
+
+  // A packet to a destination without a routing table entry is held while the route is discovered
+  m_held = Create<Packet> (20);
+  m_heldAccepted = protocol->RouteInput (m_held, header, idev, ucb, mcb, lcb, ecb);
+
+  header.SetDestination (m_unreachable);
+  m_lostAccepted = protocol->RouteInput (Create<Packet> (20), header, idev, ucb, mcb, lcb, ecb);
+
+  // A packet larger than the buffer is left to the caller to drop, without calling ecb
+  header.SetDestination (m_dst);
+  uint32_t dropped = m_dropped;
+  m_oversizedAccepted = protocol->RouteInput (Create<Packet> (100), header, idev, ucb, mcb, lcb, ecb);
+  m_droppedOnOversized = m_dropped - dropped;
+}
+
+void
+AraSalvageTestCase::Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header & header)
+{
+  m_gateways.push_back (route->GetGateway ());
+  m_packets.push_back (p);
+  m_headers.push_back (header);
+}
+
+void
+AraSalvageTestCase::Error (Ptr<const Packet> p, const Ipv4Header & header, Socket::SocketErrno err)
+{
+  ++m_dropped;
+}
+
+void
+AraSalvageTestCase::DoRun (void)
+{
+  // Source s, intermediate node x and destination d in a line: s - x - d
+  enum { S, X, D, N };
+  NodeContainer nodes;
+  nodes.Create (N);
+  SimpleNetDeviceHelper simple;
+  NetDeviceContainer devices = simple.Install (nodes);
+  Ptr<SimpleChannel> channel = DynamicCast<SimpleChannel> (devices.Get (0)->GetChannel ());
+  channel->BlackList (DynamicCast<SimpleNetDevice> (devices.Get (S)), DynamicCast<SimpleNetDevice> (devices.Get (D)));
+  channel->BlackList (DynamicCast<SimpleNetDevice> (devices.Get (D)), DynamicCast<SimpleNetDevice> (devices.Get (S)));
+
+  AraHelper ara;
+  ara.Set ("MaxQueueBytes", UintegerValue (50));
+  ara.Set ("SalvageTimeout", TimeValue (Seconds (1)));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (ara);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  m_source = interfaces.GetAddress (S);
+  m_dst = interfaces.GetAddress (D);
+  m_unreachable = Ipv4Address ("10.1.1.100");
+
+  Ptr<ara::RoutingProtocol> protocol = nodes.Get (X)->GetObject<ara::RoutingProtocol> ();
+  Simulator::Schedule (Seconds (1), &AraSalvageTestCase::Receive, this, protocol, devices.Get (X));
+  Simulator::Stop (Seconds (30));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_heldAccepted, true, "Packet without a routing table entry held");
+  NS_TEST_EXPECT_MSG_EQ (m_lostAccepted, true, "Packet to an unknown destination held");
+  NS_TEST_EXPECT_MSG_EQ (protocol->GetSalvagedPackets (), 2, "Packets counted as salvaged");
+  NS_TEST_EXPECT_MSG_EQ (m_oversizedAccepted, false, "Oversized packet not held");
+  NS_TEST_EXPECT_MSG_EQ (m_droppedOnOversized, 0, "Not reported as dropped by the buffer");
+
+  // The held packet is sent on with its original header once the route is found
+  NS_TEST_ASSERT_MSG_EQ (m_packets.size (), 1, "Packet sent on");
+  NS_TEST_EXPECT_MSG_EQ (m_packets.front (), m_held, "The held packet");
+  NS_TEST_EXPECT_MSG_EQ (m_gateways.front (), m_dst, "Sent to the next hop of the discovered route");
+  NS_TEST_EXPECT_MSG_EQ (m_headers.front ().GetSource (), m_source, "Source kept");
+  NS_TEST_EXPECT_MSG_EQ (m_headers.front ().GetTtl (), m_ttl, "TTL kept");
+  NS_TEST_EXPECT_MSG_EQ (protocol->GetSalvagedPacketsSent (), 1, "Packet counted as sent on");
+
+  // The packet whose destination is not found is dropped through ecb
+  NS_TEST_EXPECT_MSG_EQ (m_dropped, 1, "Dropped through ecb");
+  Simulator::Destroy ();
+}
+
+// Forwarded packets routed again after their link broke
+class AraLinkBreakSalvageTestCase : public TestCase
+{
+public:
+  AraLinkBreakSalvageTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send a data packet
+   * \param socket the socket to send from
+   */
+  void SendData (Ptr<Socket> socket);
+  /**
+   * Count received data packets
+   * \param socket the receiving socket
+   */
+  void ReceiveData (Ptr<Socket> socket);
+  /**
+   * Break the link between two devices
+   * \param channel the channel
+   * \param first the first device
+   * \param second the second device
+   */
+  void BreakLink (Ptr<SimpleChannel> channel, Ptr<SimpleNetDevice> first, Ptr<SimpleNetDevice> second);
+  /// Number of received data packets
+  uint32_t m_received;
+};
+
+AraLinkBreakSalvageTestCase::AraLinkBreakSalvageTestCase ()
+  : TestCase ("Ara packets routed again after a link break"),
+    m_received (0)
+{
+}
+
+void
+AraLinkBreakSalvageTestCase::SendData (Ptr<Socket> socket)
+{
+  socket->Send (Create<Packet> (100));
+}
+
+void
+AraLinkBreakSalvageTestCase::ReceiveData (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      ++m_received;
+    }
+}
+
+void
+AraLinkBreakSalvageTestCase::BreakLink (Ptr<SimpleChannel> channel, Ptr<SimpleNetDevice> first,
+                                        Ptr<SimpleNetDevice> second)
+{
+  channel->BlackList (first, second);
+  channel->BlackList (second, first);
+}
+
+void
+AraLinkBreakSalvageTestCase::DoRun (void)
+{
+  /*
+   * Source s reaches destination d through x and y, the only path within
+   * the TTL of its second route request.  x loses its link to y:
+   *
+   *   s - x - y - d
+   *        \     /
+   *         z - w
+   *
+   * The packets x forwarded to y after the break are lost on the channel.
+   * Once y expires from the neighbors of x, x routes them again over z.
+   */
+  enum { S, X, Y, Z, W, D, N };
+  NodeContainer nodes;
+  nodes.Create (N);
+  SimpleNetDeviceHelper simple;
+  NetDeviceContainer devices = simple.Install (nodes);
+  bool linked[N][N] = {};
+  uint32_t links[][2] = { { S, X }, { X, Y }, { Y, D }, { X, Z }, { Z, W }, { W, D } };
+  for (uint32_t i = 0; i < sizeof (links) / sizeof (links[0]); ++i)
+    {
+      linked[links[i][0]][links[i][1]] = true;
+      linked[links[i][1]][links[i][0]] = true;
+    }
+  Ptr<SimpleChannel> channel = DynamicCast<SimpleChannel> (devices.Get (0)->GetChannel ());
+  for (uint32_t i = 0; i < N; ++i)
+    {
+      for (uint32_t j = 0; j < N; ++j)
+        {
+          if (i != j && !linked[i][j])
+            {
+              channel->BlackList (DynamicCast<SimpleNetDevice> (devices.Get (i)),
+                                  DynamicCast<SimpleNetDevice> (devices.Get (j)));
+            }
+        }
+    }
+
+  AraHelper ara;
+  // Longer than the time from the break to the expiry of y, shorter than from the first packet
+  ara.Set ("RetransmitBufferTimeout", TimeValue (MilliSeconds (4500)));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (ara);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  Ptr<Socket> sink = Socket::CreateSocket (nodes.Get (D), UdpSocketFactory::GetTypeId ());
+  sink->Bind (InetSocketAddress (Ipv4Address::GetAny (), 9));
+  sink->SetRecvCallback (MakeCallback (&AraLinkBreakSalvageTestCase::ReceiveData, this));
+  Ptr<Socket> source = Socket::CreateSocket (nodes.Get (S), UdpSocketFactory::GetTypeId ());
+  source->Connect (InetSocketAddress (interfaces.GetAddress (D), 9));
+
+  Simulator::Schedule (Seconds (1), &AraLinkBreakSalvageTestCase::SendData, this, source);
+  Simulator::Schedule (Seconds (3), &AraLinkBreakSalvageTestCase::BreakLink, this, channel,
+                       DynamicCast<SimpleNetDevice> (devices.Get (X)), DynamicCast<SimpleNetDevice> (devices.Get (Y)));
+  for (uint32_t i = 0; i < 3; ++i)
+    {
+      Simulator::Schedule (Seconds (3) + MilliSeconds (50 * (i + 1)), &AraLinkBreakSalvageTestCase::SendData,
+                           this, source);
+    }
+  Simulator::Stop (Seconds (15));
+  Simulator::Run ();
+
+  Ptr<ara::RoutingProtocol> protocol = nodes.Get (X)->GetObject<ara::RoutingProtocol> ();
+  NS_TEST_EXPECT_MSG_EQ (protocol->GetReroutedPackets (), 3, "Packets sent into the broken link routed again");
+  NS_TEST_EXPECT_MSG_EQ (protocol->GetSalvagedPacketsSent (), 3, "Sent on over the rediscovered route");
+  NS_TEST_EXPECT_MSG_EQ (m_received, 4, "Every packet delivered once");
+  Simulator::Destroy ();
+}
+
+// Multipath route discovery over a small network
+class AraMultipathDiscoveryTestCase : public TestCase
+{
+public:
+  AraMultipathDiscoveryTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Send a data packet
+   * \param socket the socket to send from
+   */
+  void SendData (Ptr<Socket> socket);
+  /**
+   * Check that a node reaches a destination through two next hops
+   * \param node the node
+   * \param dst the destination
+   * \param first the first next hop
+   * \param second the second next hop
+   * \param msg the message to report
+   */
+  void CheckNextHops (Ptr<Node> node, Ipv4Address dst, Ipv4Address first, Ipv4Address second,
+                      std::string const & msg);
+};
+
+AraMultipathDiscoveryTestCase::AraMultipathDiscoveryTestCase ()
+  : TestCase ("Ara multipath route discovery")
+{
+}
+
+void
+AraMultipathDiscoveryTestCase::SendData (Ptr<Socket> socket)
+{
+  socket->Send (Create<Packet> (100));
+}
+
+void
+AraMultipathDiscoveryTestCase::CheckNextHops (Ptr<Node> node, Ipv4Address dst, Ipv4Address first,
+                                              Ipv4Address second, std::string const & msg)
+{
+  // Read the entry of dst from the printed routing table, one line per destination
+  std::ostringstream table;
+  node->GetObject<ara::RoutingProtocol> ()->PrintRoutingTable (Create<OutputStreamWrapper> (&table));
+  std::istringstream lines (table.str ());
+  std::ostringstream prefix;
+  prefix << dst << "\t";
+  std::string line;
+  bool found = false;
+  while (!found && std::getline (lines, line))
+    {
+      found = line.compare (0, prefix.str ().size (), prefix.str ()) == 0;
+    }
+  NS_TEST_ASSERT_MSG_EQ (found, true, msg << ": route found");
+  // Next hops are printed as "address(pheromone)"
+  std::ostringstream firstHop, secondHop;
+  firstHop << first << "(";
+  secondHop << second << "(";
+  NS_TEST_EXPECT_MSG_EQ ((line.find (firstHop.str ()) != std::string::npos), true, msg << ": through " << first);
+  NS_TEST_EXPECT_MSG_EQ ((line.find (secondHop.str ()) != std::string::npos), true, msg << ": through " << second);
+}
+
+void
+AraMultipathDiscoveryTestCase::DoRun (void)
+{
+  /*
+   * Origin o reaches x over a and b, and x reaches destination d over c and e:
+   *
+   *      a       c
+   *    /   \   /   \
+   *   o     x     d
+   *    \   /   \   /
+   *      b       e
+   *
+   * x learns two reverse paths from the FANT flood and relays the two BANTs
+   * of d over different ones, so that o learns both a and b.
+   */
+  enum { O, A, B, X, C, E, D, N };
+  NodeContainer nodes;
+  nodes.Create (N);
+  SimpleNetDeviceHelper simple;
+  NetDeviceContainer devices = simple.Install (nodes);
+  bool linked[N][N] = {};
+  uint32_t links[][2] = { { O, A }, { O, B }, { A, X }, { B, X }, { X, C }, { X, E }, { C, D }, { E, D } };
+  for (uint32_t i = 0; i < sizeof (links) / sizeof (links[0]); ++i)
+    {
+      linked[links[i][0]][links[i][1]] = true;
+      linked[links[i][1]][links[i][0]] = true;
+    }
+  Ptr<SimpleChannel> channel = DynamicCast<SimpleChannel> (devices.Get (0)->GetChannel ());
+  for (uint32_t i = 0; i < N; ++i)
+    {
+      for (uint32_t j = 0; j < N; ++j)
+        {
+          if (i != j && !linked[i][j])
+            {
+              channel->BlackList (DynamicCast<SimpleNetDevice> (devices.Get (i)),
+                                  DynamicCast<SimpleNetDevice> (devices.Get (j)));
+            }
+        }
+    }
+
+  AraHelper ara;
+  ara.Set ("MultipathDiscovery", BooleanValue (true));
+  ara.Set ("TtlStart", UintegerValue (10));
+  InternetStackHelper stack;
+  stack.SetRoutingHelper (ara);
+  stack.Install (nodes);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  Ptr<Socket> source = Socket::CreateSocket (nodes.Get (O), UdpSocketFactory::GetTypeId ());
+  source->Connect (InetSocketAddress (interfaces.GetAddress (D), 9));
+  Simulator::Schedule (Seconds (1), &AraMultipathDiscoveryTestCase::SendData, this, source);
+  Simulator::Stop (Seconds (3));
+  Simulator::Run ();
+
+  CheckNextHops (nodes.Get (X), interfaces.GetAddress (O), interfaces.GetAddress (A), interfaces.GetAddress (B),
+                 "Alternative reverse path at an intermediate node");
+  CheckNextHops (nodes.Get (D), interfaces.GetAddress (O), interfaces.GetAddress (C), interfaces.GetAddress (E),
+                 "Alternative reverse path at the destination");
+  CheckNextHops (nodes.Get (O), interfaces.GetAddress (D), interfaces.GetAddress (A), interfaces.GetAddress (B),
+                 "BANTs kept on distinct reverse paths");
+  Simulator::Destroy ();
+}
+
+// Per-packet routing table cost of forwarding a data packet
+class AraForwardingBenchmarkTestCase : public TestCase
+{
+public:
+  AraForwardingBenchmarkTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Refresh a route by copying it out of the table and back, as forwarding did
+   * before the in-place fast path
+   */
+  static void CopyRefresh (ara::RoutingTable & table, Ipv4Address dst, Time lifetime,
+                           Ipv4Address nextHop = Ipv4Address ());
+  /// Address of the i-th destination
+  static Ipv4Address GetDestination (uint32_t i);
+};
+
+AraForwardingBenchmarkTestCase::AraForwardingBenchmarkTestCase ()
+  : TestCase ("Ara forwarding fast path benchmark")
+{
+}
+
+void
+AraForwardingBenchmarkTestCase::CopyRefresh (ara::RoutingTable & table, Ipv4Address dst, Time lifetime,
+                                             Ipv4Address nextHop)
+{
+  ara::RoutingTableEntry rt;
+  if (table.LookupRoute (dst, rt) && rt.GetFlag () == ara::VALID)
+    {
+      rt.SetRreqCnt (0);
+      rt.SetLifeTime (std::max (lifetime, rt.GetLifeTime ()));
+      rt.RefreshNextHop (nextHop == Ipv4Address () ? rt.GetNextHop () : nextHop, lifetime);
+      table.Update (rt);
+    }
+}
+
+Ipv4Address
+AraForwardingBenchmarkTestCase::GetDestination (uint32_t i)
+{
+  return Ipv4Address ((10 << 24) + (1 << 16) + i + 1);
+}
+
+void
+AraForwardingBenchmarkTestCase::DoRun (void)
+{
+  const uint32_t destinations = 1000;
+  const uint32_t neighbors = 10;
+  const uint32_t packets = 100000;
+  const Time lifetime = Seconds (3);
+  Ipv4InterfaceAddress iface (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.0.0.0"));
+  ara::RoutingTable table (Seconds (5));
+  for (uint32_t n = 0; n < neighbors; ++n)
+    {
+      Ipv4Address neighbor ((10 << 24) + n + 2);
+      ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ neighbor, /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                          /*iface=*/ iface, /*hops=*/ 1, /*nextHop=*/ neighbor,
+                                          /*lifetime=*/ Seconds (10));
+      table.AddRoute (rt);
+    }
+  for (uint32_t i = 0; i < destinations; ++i)
+    {
+      Ipv4Address nextHop ((10 << 24) + (i % neighbors) + 2);
+      ara::RoutingTableEntry rt (/*dev=*/ 0, /*dst=*/ GetDestination (i), /*vSeqNo=*/ true, /*seqNo=*/ 1,
+                                          /*iface=*/ iface, /*hops=*/ 3, /*nextHop=*/ nextHop,
+                                          /*lifetime=*/ Seconds (10));
+      table.AddRoute (rt);
+    }
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t k = 0; k < packets; ++k)
+    {
+      Ipv4Address dst = GetDestination (k % destinations);
+      Ipv4Address origin = GetDestination ((7 * k + 3) % destinations);
+      ara::RoutingTableEntry toDst;
+      table.LookupRoute (dst, toDst);
+      Ptr<Ipv4Route> route = toDst.GetRoute ();
+      CopyRefresh (table, origin, lifetime);
+      CopyRefresh (table, dst, lifetime, route->GetGateway ());
+      CopyRefresh (table, route->GetGateway (), lifetime);
+      ara::RoutingTableEntry toOrigin;
+      table.LookupRoute (origin, toOrigin);
+      CopyRefresh (table, toOrigin.GetNextHop (), lifetime);
+    }
+  int64_t copyMs = clock.End ();
+
+  clock.Start ();
+  for (uint32_t k = 0; k < packets; ++k)
+    {
+      Ipv4Address dst = GetDestination (k % destinations);
+      Ipv4Address origin = GetDestination ((7 * k + 3) % destinations);
+      ara::RoutingTableEntry const * toDst = table.FindRoute (dst);
+      Ptr<Ipv4Route> route = toDst->GetRoute ();
+      table.RefreshForwardingPath (toDst, route->GetGateway (), origin, lifetime);
+    }
+  int64_t fastMs = clock.End ();
+
+  std::cout << "Routing table cost per forwarded packet with " << destinations << " destinations: "
+            << 1e6 * copyMs / packets << " ns copying entries, "
+            << 1e6 * fastMs / packets << " ns in place" << std::endl;
+
+  ara::RoutingTableEntry const * toDst = table.FindRoute (GetDestination (0));
+  Ipv4Address prev = table.RefreshForwardingPath (toDst, toDst->GetNextHop (), GetDestination (1), Seconds (20));
+  NS_TEST_EXPECT_MSG_EQ (prev, Ipv4Address ((10 << 24) + 3), "Previous hop is the next hop towards the origin");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (GetDestination (0))->GetLifeTime (), Seconds (20), "Destination refreshed");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (GetDestination (1))->GetLifeTime (), Seconds (20), "Origin refreshed");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (prev)->GetLifeTime (), Seconds (20), "Previous hop refreshed");
+  NS_TEST_EXPECT_MSG_EQ (table.FindRoute (toDst->GetNextHop ())->GetLifeTime (), Seconds (20), "Next hop refreshed");
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -61,8 +2075,48 @@ AraTestSuite::AraTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new AraTestCase1, TestCase::QUICK);
+  AddTestCase (new AraBantHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new AraPheromoneTableTestCase, TestCase::QUICK);
+  AddTestCase (new AraRouteSelectionTestCase, TestCase::QUICK);
+  AddTestCase (new AraEvaporationTestCase, TestCase::QUICK);
+  AddTestCase (new AraExpiryIndexTestCase, TestCase::QUICK);
+  AddTestCase (new AraNextHopIndexTestCase, TestCase::QUICK);
+  AddTestCase (new AraInPlaceAccessTestCase, TestCase::QUICK);
+  AddTestCase (new AraNodeIdTestCase, TestCase::QUICK);
+  AddTestCase (new AraPrecursorSetTestCase, TestCase::QUICK);
+  AddTestCase (new AraRouteCacheTestCase, TestCase::QUICK);
+  AddTestCase (new AraRequestQueueTestCase, TestCase::QUICK);
+  AddTestCase (new AraRetransmitBufferTestCase, TestCase::QUICK);
+  AddTestCase (new AraIdCacheTestCase, TestCase::QUICK);
+  AddTestCase (new AraIdWindowTestCase, TestCase::QUICK);
+  AddTestCase (new AraFantPathCacheTestCase, TestCase::QUICK);
+  AddTestCase (new AraBloomDpdTestCase, TestCase::QUICK);
+  AddTestCase (new AraNeighborsTestCase, TestCase::QUICK);
+  AddTestCase (new AraLinkQualityTestCase, TestCase::QUICK);
+  AddTestCase (new AraLinkQualityEstimateTestCase, TestCase::QUICK);
+  AddTestCase (new AraReinforcementTestCase, TestCase::QUICK);
+  AddTestCase (new AraFailOverTestCase, TestCase::QUICK);
+  AddTestCase (new AraSalvageTestCase, TestCase::QUICK);
+  AddTestCase (new AraLinkBreakSalvageTestCase, TestCase::QUICK);
+  AddTestCase (new AraMultipathDiscoveryTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
 static AraTestSuite araTestSuite;
 
+// Benchmarks are kept out of the unit suite so that they do not slow down regular test runs
+class AraPerformanceTestSuite : public TestSuite
+{
+public:
+  AraPerformanceTestSuite ();
+};
+
+AraPerformanceTestSuite::AraPerformanceTestSuite ()
+  : TestSuite ("ara-performance", PERFORMANCE)
+{
+  AddTestCase (new AraForwardingBenchmarkTestCase, TestCase::QUICK);
+  AddTestCase (new AraNeighborTimerBenchmarkTestCase, TestCase::QUICK);
+}
+
+static AraPerformanceTestSuite araPerformanceTestSuite;
+